@@ -11,7 +11,7 @@
 
 #include "main.hpp"
 
-#include <Server.hpp>
+#include <StaticServer.hpp>
 #include <Stm32NetXTelnet.hpp>
 
 #include "eth.h"
@@ -73,9 +73,17 @@ void connection_end(NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_con
  * @see mainLoopThread() in AZURE_RTOS/App/app_azure_rtos.c
  */
 void loop() {
-    static Stm32NetXTelnet::Server telnetServer;
+    static Stm32NetXTelnet::SessionManager<> telnetSessions;
+    static Stm32NetXTelnet::StaticServer<> telnetServer(&telnetSessions);
     static UCHAR stackTelnet[2048];
+    static TX_THREAD threadTelnetLoop;
+    static UCHAR stackTelnetLoop[2048];
+    static NX_PACKET_POOL poolTelnetBulk;
+    alignas(ULONG) static UCHAR poolTelnetBulkArea[8 * (1536 + sizeof(NX_PACKET))];
+    static NX_PACKET_POOL poolTelnetSmall;
+    alignas(ULONG) static UCHAR poolTelnetSmallArea[16 * (128 + sizeof(NX_PACKET))];
     static Stm32Common::RunOnce roTelnet;
+    static bool telnetStarted = false;
 
     if (Stm32NetX::NX->isIpSet()) {
         roTelnet.loop([]() {
@@ -84,6 +92,13 @@ void loop() {
 
             telnetServer.setLogger(&Logger);
 
+            // Keep telnet output from starving the packet pool of the IP instance
+            nx_packet_pool_create(&poolTelnetBulk, (CHAR *) "Telnet TX", 1536,
+                                  poolTelnetBulkArea, sizeof(poolTelnetBulkArea));
+            nx_packet_pool_create(&poolTelnetSmall, (CHAR *) "Telnet TX small", 128,
+                                  poolTelnetSmallArea, sizeof(poolTelnetSmallArea));
+            telnetServer.setTxPacketPools(&poolTelnetBulk, &poolTelnetSmall);
+
             telnetServer.create(
                 (char *) "Telnet Server",
                 Stm32NetX::NX->getIpInstance(),
@@ -102,15 +117,32 @@ void loop() {
             //     connection_end
             // );
 
+            // Raw monitoring port, which receives the counter below
+            Stm32NetXTelnet::PortPolicy monitorPolicy{};
+            monitorPolicy.raw = true;
+            telnetServer.addPort(2323, 1, monitorPolicy);
+
             telnetServer.start();
+            telnetStarted = true;
+
+            // Process the telnet sessions as soon as something happens, instead of polling them every tick.
+            // The telnet server thread adds and removes sessions under the session mutex of the server.
+            tx_thread_create(&threadTelnetLoop, (CHAR *) "Telnet loop()", [](ULONG) {
+                for (;;) {
+                    telnetServer.await();
+                }
+            }, 0, stackTelnetLoop, sizeof(stackTelnetLoop), 15, 15, TX_NO_TIME_SLICE, TX_AUTO_START);
         });
-
-        telnetServer.loop();
     }
 
     static Stm32Common::RunEvery re1(3000);
     re1.loop([]() {
-        // telnetServer.broadcast()->printf("counter = %d\r\n", dummyCpp);
+        // Only monitoring sessions get the counter, it would clutter the interactive consoles
+        if (telnetStarted) {
+            telnetServer.broadcast([](const Stm32NetXTelnet::LogicalConnectionMicrorl *session) {
+                return session->isRaw();
+            })->printf("counter = %d\r\n", dummyCpp);
+        }
     });
 
     static Stm32Common::RunEvery re2(300);
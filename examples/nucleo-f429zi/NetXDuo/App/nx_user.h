@@ -709,9 +709,13 @@
 
 /* Defined, disables the reset processing during disconnect when the timeout
    value supplied is specified as NX_NO_WAIT. */
-/*
+/* The telnet server closes without waiting, a graceful close needs a FIN instead of a RST */
 #define NX_DISABLE_RESET_DISCONNECT
-*/
+
+/* Defined, every telnet server brings its own client list. The StaticServer
+   holds the list of its own connections, instead of NX_TELNET_MAX_CLIENTS
+   clients inside every server. */
+#define NX_TELNET_SERVER_USER_CLIENT_LIST
 
 /* Defined, enables the verification of minimum peer MSS before accepting a TCP
    connection. To use this feature, the symbol NX_ENABLE_TCP_MSS_MINIMUM must
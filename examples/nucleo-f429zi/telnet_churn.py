@@ -0,0 +1,220 @@
+#!/bin/python3
+#
+#  This program is free software. It comes without any
+#  warranty, to the extent permitted by applicable law.
+#
+
+"""
+Connection churn benchmark for the telnet server of the example.
+
+storm: Opens one established probe session and keeps typing into it, while
+       bursts of clients connect at once, wait for the first byte of the
+       server and leave again. Reports how fast the clients get an answer and
+       the echo latency of the probe session during the storm, which stays
+       low as long as accepting never blocks the server thread.
+
+cycle: Parallel clients connect, wait for the banner, run one command and
+       disconnect again in a loop, like monitoring scripts do. Reports the
+       cycles per second and how often a client found all slots in use, which
+       shows how fast the close policy of the server recycles the slots.
+
+Usage: telnet_churn.py <host> [port] [--mode storm|cycle] [--clients N] [--rounds N]
+                       [--command CMD] [--duration SECONDS]
+"""
+
+import argparse
+import socket
+import statistics
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+IAC = 0xff
+
+
+def percentiles(values):
+    """ Returns min, median, 95th percentile and max of a list of seconds as milliseconds """
+    if not values:
+        return 'no samples'
+    values = sorted(values)
+    p95 = values[min(len(values) - 1, int(len(values) * 0.95))]
+    return 'min %.1f ms, median %.1f ms, p95 %.1f ms, max %.1f ms' % (
+        values[0] * 1000, statistics.median(values) * 1000, p95 * 1000, values[-1] * 1000)
+
+
+def strip_telnet(data):
+    """ Removes the telnet commands from received data, a command split between two reads is lost """
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        if data[i] != IAC:
+            out.append(data[i])
+            i += 1
+        elif i + 1 < len(data) and data[i + 1] == 250:
+            # Subnegotiation up to IAC SE
+            end = data.find(bytes([IAC, 240]), i)
+            i = len(data) if end < 0 else end + 2
+        else:
+            i += 3
+    return bytes(out)
+
+
+def connect_once(host, port, timeout):
+    """ Connects, waits for the first byte of the server and closes. Returns (seconds, outcome) """
+    start = time.monotonic()
+    try:
+        with socket.create_connection((host, port), timeout=timeout) as sock:
+            data = sock.recv(256)
+            elapsed = time.monotonic() - start
+            if not data:
+                return elapsed, 'closed'
+            if b'busy' in data:
+                return elapsed, 'busy'
+            return elapsed, 'ok'
+    except OSError:
+        return time.monotonic() - start, 'failed'
+
+
+def receive_until(sock, done):
+    """ Receives until done() returns true for the text received so far. Returns the text """
+    data = b''
+    while not done(data):
+        chunk = sock.recv(256)
+        if not chunk:
+            break
+        data += strip_telnet(chunk)
+    return data
+
+
+def cycle_once(host, port, command, timeout):
+    """ Connects, runs one command and disconnects. Returns (seconds, outcome) """
+    start = time.monotonic()
+    try:
+        with socket.create_connection((host, port), timeout=timeout) as sock:
+            banner = receive_until(sock, lambda data: b'OK' in data or b'busy' in data)
+            if b'busy' in banner:
+                return time.monotonic() - start, 'busy'
+            if b'OK' not in banner:
+                return time.monotonic() - start, 'closed'
+            # The echo of the command line and the first line of its output
+            sock.sendall(command.encode() + b'\r\n')
+            reply = receive_until(sock, lambda data: data.count(b'\n') >= 2)
+            if reply.count(b'\n') < 2:
+                return time.monotonic() - start, 'closed'
+        return time.monotonic() - start, 'ok'
+    except OSError:
+        return time.monotonic() - start, 'failed'
+
+
+class Probe(threading.Thread):
+    """ Established session, that types a character and measures the time until it is echoed """
+
+    def __init__(self, host, port, interval):
+        super().__init__(daemon=True)
+        self.sock = socket.create_connection((host, port), timeout=5)
+        self.interval = interval
+        self.latencies = []
+        self.timeouts = 0
+        self.running = True
+        # Let the banner and the negotiation pass
+        time.sleep(1)
+        self.sock.settimeout(0.2)
+        try:
+            while self.sock.recv(1024):
+                pass
+        except socket.timeout:
+            pass
+        self.sock.settimeout(2)
+
+    def run(self):
+        while self.running:
+            start = time.monotonic()
+            self.sock.sendall(b'x')
+            try:
+                data = b''
+                while b'x' not in strip_telnet(data):
+                    data = self.sock.recv(256)
+                    if not data:
+                        raise ConnectionError('probe session closed by the server')
+                self.latencies.append(time.monotonic() - start)
+            except socket.timeout:
+                self.timeouts += 1
+            # Remove the character again, so the line never fills up
+            self.sock.sendall(b'\x7f')
+            time.sleep(self.interval)
+
+    def stop(self):
+        self.running = False
+        self.join()
+        self.sock.close()
+
+
+def storm(args):
+    probe = Probe(args.host, args.port, 0.05)
+    probe.start()
+    time.sleep(1)
+    idle = list(probe.latencies)
+
+    results = []
+    start = time.monotonic()
+    with ThreadPoolExecutor(max_workers=args.clients) as pool:
+        for _ in range(args.rounds):
+            results += pool.map(lambda _: connect_once(args.host, args.port, args.timeout), range(args.clients))
+    duration = time.monotonic() - start
+    probe.stop()
+
+    busy = probe.latencies[len(idle):]
+    print('connections:   %d in %.1f s, %.1f per second' % (len(results), duration, len(results) / duration))
+    for outcome in ('ok', 'busy', 'closed', 'failed'):
+        times = [elapsed for elapsed, result in results if result == outcome]
+        print('  %-6s       %4d  %s' % (outcome, len(times), percentiles(times) if times else ''))
+    print('echo idle:     %s' % percentiles(idle))
+    print('echo in storm: %s, %d timeouts' % (percentiles(busy), probe.timeouts))
+
+
+def cycle(args):
+    results = []
+    lock = threading.Lock()
+    deadline = time.monotonic() + args.duration
+
+    def worker():
+        while time.monotonic() < deadline:
+            result = cycle_once(args.host, args.port, args.command, args.timeout)
+            with lock:
+                results.append(result)
+
+    start = time.monotonic()
+    threads = [threading.Thread(target=worker) for _ in range(args.clients)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    duration = time.monotonic() - start
+
+    ok = sum(1 for _, result in results if result == 'ok')
+    print('cycles:        %d in %.1f s, %.1f per second, %.1f completed per second' % (
+        len(results), duration, len(results) / duration, ok / duration))
+    for outcome in ('ok', 'busy', 'closed', 'failed'):
+        times = [elapsed for elapsed, result in results if result == outcome]
+        print('  %-6s       %4d  %s' % (outcome, len(times), percentiles(times) if times else ''))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Connection churn benchmark for the telnet server')
+    parser.add_argument('host')
+    parser.add_argument('port', type=int, nargs='?', default=23)
+    parser.add_argument('--mode', choices=('storm', 'cycle'), default='storm')
+    parser.add_argument('--clients', type=int, default=8, help='clients connecting at once')
+    parser.add_argument('--rounds', type=int, default=20, help='number of bursts (storm)')
+    parser.add_argument('--command', default='M115', help='command each client runs (cycle)')
+    parser.add_argument('--duration', type=float, default=30, help='seconds to run (cycle)')
+    parser.add_argument('--timeout', type=float, default=5, help='seconds to wait for the server')
+    args = parser.parse_args()
+    if args.mode == 'cycle':
+        cycle(args)
+    else:
+        storm(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,77 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "Broadcast.hpp"
+#include "Server.hpp"
+
+size_t Stm32NetXTelnet::Broadcast::write(uint8_t data) {
+    if (!isReady()) return 0;
+    Server::SessionLock lock(&server->sessionMutex);
+    if (length >= sizeof(scratch)) {
+        flush();
+    }
+    scratch[length++] = data;
+
+    // Complete lines go out at once
+    if (data == '\n' || length >= sizeof(scratch)) {
+        flush();
+    }
+    return 1;
+}
+
+size_t Stm32NetXTelnet::Broadcast::write(const uint8_t *buffer, size_t size) {
+    if (!isReady()) return 0;
+    Server::SessionLock lock(&server->sessionMutex);
+    // Keep the order of previously collected bytes
+    flush();
+    server->broadcastWrite(buffer, size, filter);
+    return size;
+}
+
+size_t Stm32NetXTelnet::Broadcast::getWriteBuffer(uint8_t *&buffer) {
+    if (!isReady()) return 0;
+    // The scratch buffer belongs to this thread, until it commits with setWrittenBytes()
+    tx_mutex_get(&server->sessionMutex, TX_WAIT_FOREVER);
+    buffer = scratch + length;
+    return sizeof(scratch) - length;
+}
+
+size_t Stm32NetXTelnet::Broadcast::setWrittenBytes(size_t size) {
+    // Only the thread, that got the scratch buffer with getWriteBuffer(), commits
+    if (!isReady() || server->sessionMutex.tx_mutex_owner != tx_thread_identify()) return 0;
+    if (size > sizeof(scratch) - length) size = sizeof(scratch) - length;
+    length += size;
+
+    // Formatted output is complete, fan it out
+    flush();
+    tx_mutex_put(&server->sessionMutex);
+    return size;
+}
+
+int Stm32NetXTelnet::Broadcast::availableForWrite() {
+    return static_cast<int>(sizeof(scratch) - length);
+}
+
+void Stm32NetXTelnet::Broadcast::flush() {
+    if (!isReady()) return;
+    Server::SessionLock lock(&server->sessionMutex);
+    if (length == 0) return;
+    server->broadcastWrite(scratch, length, filter);
+    length = 0;
+}
+
+void Stm32NetXTelnet::Broadcast::setFilter(Filter fltr) {
+    if (!isReady()) return;
+    Server::SessionLock lock(&server->sessionMutex);
+    if (fltr != filter) {
+        flush();
+        filter = fltr;
+    }
+}
+
+bool Stm32NetXTelnet::Broadcast::isReady() const {
+    // The session mutex exists from Server::create() until Server::del()
+    return server->sessionMutex.tx_mutex_id != 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBSMART_STM32NETXTELNET_BROADCAST_HPP
+#define LIBSMART_STM32NETXTELNET_BROADCAST_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <libsmart_config.hpp>
+#include "Loggable.hpp"
+
+namespace Stm32NetXTelnet {
+    class Server;
+    class LogicalConnectionMicrorl;
+
+    /**
+     * @brief Output stream that sends the same data to all sessions of a server.
+     *
+     * Data is formatted once into a scratch buffer and then copied into the output of every
+     * subscribed session that passes the filter. Bulk writes, like printf(), are fanned out
+     * immediately, single bytes are collected up to the end of the line or until flush() is called.
+     *
+     * The scratch buffer and the fan-out are guarded by the session mutex of the server. A thread
+     * holds it from getWriteBuffer() until it commits with setWrittenBytes().
+     * Until the server is created, the stream drops all output.
+     */
+    class Broadcast : public Stm32Common::Print {
+    public:
+        friend Server;
+
+        /**
+         * @brief Decides, if a session receives the broadcast.
+         *
+         * @param session The session to check.
+         *
+         * @return true, if the session receives the data.
+         */
+        using Filter = bool (*)(const LogicalConnectionMicrorl *session);
+
+        explicit Broadcast(Server *server) : server(server) { ; }
+
+        size_t write(uint8_t data) override;
+
+        size_t write(const uint8_t *buffer, size_t size) override;
+
+        using Print::write;
+
+        size_t getWriteBuffer(uint8_t *&buffer) override;
+
+        size_t setWrittenBytes(size_t size) override;
+
+        int availableForWrite() override;
+
+        /**
+         * @brief Sends the collected data to the sessions.
+         */
+        void flush() override;
+
+    protected:
+        /**
+         * @brief Sets the filter for the following output.
+         *
+         * Data collected for the previous filter is sent first.
+         *
+         * @param fltr The filter or nullptr to send to all subscribed sessions.
+         */
+        void setFilter(Filter fltr);
+
+    private:
+        /**
+         * @brief Checks, if the server is created and its session mutex may be used.
+         *
+         * @return true, if output can be sent.
+         */
+        bool isReady() const;
+
+        Server *server;
+        Filter filter{};
+        uint8_t scratch[LIBSMART_STM32NETXTELNET_BUFFER_SIZE_BROADCAST]{};
+        size_t length{};
+    };
+}
+
+#endif
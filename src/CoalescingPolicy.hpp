@@ -0,0 +1,30 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBSMART_STM32NETXTELNET_COALESCINGPOLICY_HPP
+#define LIBSMART_STM32NETXTELNET_COALESCINGPOLICY_HPP
+
+#include <cstddef>
+#include <libsmart_config.hpp>
+#include "tx_api.h"
+
+namespace Stm32NetXTelnet {
+    /**
+     * @brief Rules for holding back small writes of a session to send fewer, larger TCP segments.
+     *
+     * Pending output is sent, as soon as one of the following is true:
+     * - the session is flushed or the line editor has echoed input
+     * - at least highWatermark bytes are pending or the output buffer is full
+     * - at least lowWatermark bytes are pending and no segment is waiting for an ACK
+     * - the oldest pending byte waits for maxDelay ticks
+     */
+    struct CoalescingPolicy {
+        size_t lowWatermark = LIBSMART_STM32NETXTELNET_TX_LOW_WATERMARK;
+        size_t highWatermark = LIBSMART_STM32NETXTELNET_TX_HIGH_WATERMARK;
+        ULONG maxDelay = LIBSMART_STM32NETXTELNET_TX_MAX_DELAY;
+    };
+}
+
+#endif
@@ -6,6 +6,23 @@
 #include "LogicalConnection.hpp"
 #include <climits>
 
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_TX
+size_t Stm32NetXTelnet::LogicalConnection::getWriteBuffer(uint8_t *&buffer) {
+    return txPacket.getWriteBuffer(buffer);
+}
+
+size_t Stm32NetXTelnet::LogicalConnection::setWrittenBytes(size_t size) {
+    return txPacket.setWrittenBytes(size);
+}
+
+size_t Stm32NetXTelnet::LogicalConnection::write(uint8_t data) {
+    return txPacket.write(data);
+}
+
+int Stm32NetXTelnet::LogicalConnection::availableForWrite() {
+    return txPacket.availableForWrite() > INT_MAX ? INT_MAX : static_cast<int>(txPacket.availableForWrite());
+}
+#else
 size_t Stm32NetXTelnet::LogicalConnection::getWriteBuffer(uint8_t *&buffer) {
     buffer = txBuffer.getWritePointer();
     return txBuffer.getRemainingSpace();
@@ -25,6 +42,7 @@ size_t Stm32NetXTelnet::LogicalConnection::write(uint8_t data) {
 int Stm32NetXTelnet::LogicalConnection::availableForWrite() {
     return txBuffer.getRemainingSpace() > INT_MAX ? INT_MAX : static_cast<int>(txBuffer.getRemainingSpace());
 }
+#endif
 
 void Stm32NetXTelnet::LogicalConnection::flush() {
     loop();
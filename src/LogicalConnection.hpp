@@ -8,6 +8,7 @@
 
 #include "Loggable.hpp"
 #include "Nameable.hpp"
+#include "TxPacket.hpp"
 
 namespace Stm32NetXTelnet {
     class Server;
@@ -38,7 +39,11 @@ namespace Stm32NetXTelnet {
 
     private:
         Stm32Common::StringBuffer<LIBSMART_STM32NETXTELNET_BUFFER_SIZE_RX> rxBuffer{};
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_TX
+        TxPacket txPacket{};
+#else
         Stm32Common::StringBuffer<LIBSMART_STM32NETXTELNET_BUFFER_SIZE_TX> txBuffer{};
+#endif
     };
 }
 
@@ -5,8 +5,10 @@
 
 #include "LogicalConnectionMicrorl.hpp"
 #include <climits>
+#include <cstring>
 #include <microrl.h>
 #include "globals.hpp"
+#include "Server.hpp"
 #include "Stm32GcodeRunner.hpp"
 
 using namespace Stm32NetXTelnet;
@@ -18,11 +20,208 @@ LogicalConnectionMicrorl::LogicalConnectionMicrorl() : microrl() {
 LogicalConnectionMicrorl::~LogicalConnectionMicrorl() {
     getRxBuffer()->clear();
     getTxBuffer()->clear();
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_TX
+    txPacket.clear();
+#endif
+#ifdef LIBSMART_STM32NETXTELNET_TX_RING
+    txRing.clear();
+#endif
+    if (txPendingPacket != nullptr) {
+        nx_packet_release(txPendingPacket);
+        txPendingPacket = nullptr;
+    }
+    rxQueue.clear();
+#ifdef LIBSMART_STM32NETXTELNET_TX_RING
+    if (txRingMutex.tx_mutex_id != 0) {
+        tx_mutex_delete(&txRingMutex);
+    }
+#endif
     microrl_t{};
 }
 
 void LogicalConnectionMicrorl::flush() {
     loop();
+    txFlush = true;
+    if (server != nullptr) {
+        server->notify(Server::Event::TX);
+    }
+}
+
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_TX
+size_t LogicalConnectionMicrorl::getWriteBuffer(uint8_t *&buffer) {
+    // Server::loop() detaches and sends the packet under the session mutex, it is held until setWrittenBytes()
+    const auto srv = server;
+    if (srv == nullptr || tx_mutex_get(&srv->sessionMutex, TX_WAIT_FOREVER) != TX_SUCCESS) return 0;
+    const auto ret = txPacket.getWriteBuffer(buffer);
+    if (ret == 0) {
+        tx_mutex_put(&srv->sessionMutex);
+        return 0;
+    }
+    txPacketLock = &srv->sessionMutex;
+    return ret;
+}
+
+size_t LogicalConnectionMicrorl::setWrittenBytes(size_t size) {
+    // end() may have cleared the server meanwhile, the lock is released on the mutex it was taken on
+    const auto lock = txPacketLock;
+    if (lock == nullptr) return 0;
+    txPacketLock = nullptr;
+    size_t ret = 0;
+    if (txPacket.availableForWrite() > 0) {
+        uint8_t *buffer{};
+        const auto space = txPacket.getWriteBuffer(buffer);
+        size_t escaped{};
+        ret = escapeOutput(buffer, size, space, escaped);
+        txPacket.setWrittenBytes(escaped);
+        notifyTx();
+    }
+    tx_mutex_put(lock);
+    return ret;
+}
+
+size_t LogicalConnectionMicrorl::write(uint8_t data) {
+    if (data == TelnetCodec::IAC && !raw) {
+        return write(&data, 1);
+    }
+    const auto srv = server;
+    if (srv == nullptr) return 0;
+    Server::SessionLock lock(&srv->sessionMutex);
+    const auto ret = txPacket.write(data);
+    notifyTx();
+    return ret;
+}
+
+int LogicalConnectionMicrorl::availableForWrite() {
+    return txPacket.availableForWrite() > INT_MAX ? INT_MAX : static_cast<int>(txPacket.availableForWrite());
+}
+#elif defined(LIBSMART_STM32NETXTELNET_TX_RING)
+size_t LogicalConnectionMicrorl::getWriteBuffer(uint8_t *&buffer) {
+    // Writers blocked by the reservation wait on the mutex, which lends them the priority of the holder
+    if (tx_mutex_get(&txRingMutex, TX_WAIT_FOREVER) != TX_SUCCESS) return 0;
+    const auto ret = txRing.reserveAll(buffer);
+    if (ret == 0) {
+        tx_mutex_put(&txRingMutex);
+        return 0;
+    }
+    txRingOwner = tx_thread_identify();
+    txRingReserved = ret;
+    return ret;
+}
+
+size_t LogicalConnectionMicrorl::setWrittenBytes(size_t size) {
+    // Only the thread holding the open reservation may commit it
+    if (txRingReserved == 0 || txRingOwner != tx_thread_identify()) return 0;
+    const auto reserved = txRingReserved;
+    txRingReserved = 0;
+    txRingOwner = nullptr;
+    if (size > reserved) size = reserved;
+    txRing.commitAll(reserved, size);
+    tx_mutex_put(&txRingMutex);
+    notifyTx();
+    return size;
+}
+
+size_t LogicalConnectionMicrorl::write(uint8_t data) {
+    return write(&data, 1);
+}
+
+size_t LogicalConnectionMicrorl::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        uint8_t *span{};
+        const auto n = txRing.reserve(span, size - written);
+        if (n == 0) {
+            // Wait for the open reservation of another thread to be committed, a full ring drops the rest
+            if (txRing.isBlocked() && txRingOwner != tx_thread_identify()
+                && tx_mutex_get(&txRingMutex, TX_WAIT_FOREVER) == TX_SUCCESS) {
+                tx_mutex_put(&txRingMutex);
+                continue;
+            }
+            break;
+        }
+        memcpy(span, buffer + written, n);
+        txRing.commit();
+        written += n;
+    }
+    notifyTx();
+    return written;
+}
+
+int LogicalConnectionMicrorl::availableForWrite() {
+    return txRing.availableForWrite() > INT_MAX ? INT_MAX : static_cast<int>(txRing.availableForWrite());
+}
+#else
+size_t LogicalConnectionMicrorl::getWriteBuffer(uint8_t *&buffer) {
+    buffer = getTxBuffer()->getWritePointer();
+    return getTxBuffer()->getRemainingSpace();
+}
+
+size_t LogicalConnectionMicrorl::setWrittenBytes(size_t size) {
+    size_t escaped{};
+    const auto ret = escapeOutput(getTxBuffer()->getWritePointer(), size,
+                                  getTxBuffer()->getRemainingSpace(), escaped);
+    getTxBuffer()->setWrittenBytes(escaped);
+    notifyTx();
+    return ret;
+}
+
+size_t LogicalConnectionMicrorl::write(uint8_t data) {
+    if (data == TelnetCodec::IAC && !raw) {
+        return write(&data, 1);
+    }
+    const auto ret = StreamRxTx::write(data);
+    notifyTx();
+    return ret;
+}
+#endif
+
+#ifndef LIBSMART_STM32NETXTELNET_TX_RING
+size_t LogicalConnectionMicrorl::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+        uint8_t *writeBuffer{};
+        auto space = getWriteBuffer(writeBuffer);
+        if (space == 0) {
+            break;
+        }
+        if (space > size - written) space = size - written;
+        memcpy(writeBuffer, buffer + written, space);
+        // An escaped IAC may not fit into the rest of the buffer
+        const auto added = setWrittenBytes(space);
+        if (added == 0) {
+            break;
+        }
+        written += added;
+    }
+    return written;
+}
+#endif
+
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_RX
+int LogicalConnectionMicrorl::available() {
+    const auto size = rxQueue.available();
+    return size > INT_MAX ? INT_MAX : static_cast<int>(size);
+}
+
+int LogicalConnectionMicrorl::read() {
+    const uint8_t *span{};
+    if (rxQueue.getReadSpan(span) == 0) return -1;
+    const auto ch = *span;
+    rxQueue.consume(1);
+    return ch;
+}
+
+int LogicalConnectionMicrorl::peek() {
+    const uint8_t *span{};
+    if (rxQueue.getReadSpan(span) == 0) return -1;
+    return *span;
+}
+#endif
+
+void LogicalConnectionMicrorl::notifyTx() {
+    if (server == nullptr || txNotified) return;
+    txNotified = true;
+    server->notify(Server::Event::TX);
 }
 
 int LogicalConnectionMicrorl::microrlOutput(microrl *mrl, const char *str) {
@@ -30,6 +229,8 @@ int LogicalConnectionMicrorl::microrlOutput(microrl *mrl, const char *str) {
             ->println("Stm32NetXTelnet::LogicalConnection::microrlOutput()");
 
     write(str);
+    // The echo of the line editor is sent at once, it is never coalesced
+    txEcho = true;
     return 0;
 }
 
@@ -57,17 +258,33 @@ int LogicalConnectionMicrorl::microrlExec(microrl *mrl, int argc, const char *co
 
         cmdCtx->registerOnWriteFunction([cmdCtx, this]() {
             // Debugger_log(DBG, "onWriteFn()");
+            const auto srv = server;
+            if (srv == nullptr) return;
+            Server::SessionLock lock(&srv->sessionMutex);
+            // The connection may have ended since, and the session may serve the next one already
+            if (!isCommandContext(cmdCtx)) return;
             if (cmdCtx->outputLength() > 0) {
-                const auto result = cmdCtx->outputRead(
-                    reinterpret_cast<char *>(this->getTxBuffer()->getWritePointer()),
-                    this->getTxBuffer()->getRemainingSpace());
-                this->getTxBuffer()->setWrittenBytes(result);
+                uint8_t *buffer{};
+                const auto space = this->getWriteBuffer(buffer);
+                if (space > 0) {
+                    const auto result = cmdCtx->outputRead(reinterpret_cast<char *>(buffer), space);
+                    this->setWrittenBytes(result);
+                }
             }
         });
 
         cmdCtx->registerOnCmdEndFunction([cmdCtx, this]() {
             // Debugger_log(DBG, "onCmdEndFn()");
-            cmd = nullptr;
+            const auto srv = server;
+            if (srv != nullptr) {
+                Server::SessionLock lock(&srv->sessionMutex);
+                // end() has let go of a terminated command already
+                if (isCommandContext(cmdCtx)) {
+                    cmd = nullptr;
+                    // Input received while the command was running is processed now
+                    srv->notify(Server::Event::RX);
+                }
+            }
             Stm32GcodeRunner::worker->deleteCommandContext(cmdCtx);
         });
 
@@ -87,6 +304,20 @@ void LogicalConnectionMicrorl::setup() {
     log(Stm32ItmLogger::LoggerInterface::Severity::INFORMATIONAL)
             ->println("Stm32NetXTelnet::LogicalConnection::setup()");
 
+    telnetCodec.reset();
+    telnetOptions.reset();
+
+#ifdef LIBSMART_STM32NETXTELNET_TX_RING
+    // Created once, the session is reused for later connections
+    if (txRingMutex.tx_mutex_id == 0) {
+        const auto mutexRet = tx_mutex_create(&txRingMutex, (CHAR *) "Telnet TX ring", TX_INHERIT);
+        if (mutexRet != TX_SUCCESS) {
+            log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
+                    ->printf("tx_mutex_create() = 0x%02x\r\n", mutexRet);
+        }
+    }
+#endif
+
     /* Initialize library with microrl instance and print and execute callbacks */
     auto ret = microrl_init(this,
                             bounce<LogicalConnectionMicrorl, decltype(&LogicalConnectionMicrorl::microrlOutput),
@@ -114,6 +345,27 @@ void LogicalConnectionMicrorl::setup() {
 
     microrl_set_prompt(this, (char *) "");
 
+    if (raw) {
+        // Tools get no banner and no prompt
+        return;
+    }
+
+    // The whole negotiation of the server leaves in one segment.
+    // Server::new_connection() holds the session mutex, which guards the negotiation.
+    telnetOptions.request(TelnetOptions::Side::LOCAL, TelnetOptions::OPTION_ECHO, true, *this);
+    telnetOptions.request(TelnetOptions::Side::LOCAL, TelnetOptions::OPTION_SGA, true, *this);
+    telnetOptions.request(TelnetOptions::Side::REMOTE, TelnetOptions::OPTION_NAWS, true, *this);
+    telnetOptions.request(TelnetOptions::Side::REMOTE, TelnetOptions::OPTION_TTYPE, true, *this);
+    if (linemodeWanted) {
+        telnetOptions.request(TelnetOptions::Side::REMOTE, TelnetOptions::OPTION_LINEMODE, true, *this);
+    }
+
+    // setup() runs on the telnet server thread, the banner is written by the first loop()
+    greetingPending = true;
+}
+
+void LogicalConnectionMicrorl::greet() {
+    greetingPending = false;
 
     println();
     print(FIRMWARE_NAME);
@@ -121,66 +373,358 @@ void LogicalConnectionMicrorl::setup() {
     print(FIRMWARE_VERSION);
     print(F(" "));
     println(FIRMWARE_COPY);
-    flush();
-    delay(500);
     print(F("OK"));
-    flush();
 
+    // The prompt sends the banner without waiting for the coalescing delay
     microrl_processing_input(this, "\n", 1);
 }
 
 void LogicalConnectionMicrorl::loop() {
-    if (cmd != nullptr) return;
-    while (available() > 0) {
-        auto ch = read();
+    if (greetingPending) {
+        greet();
+    }
 
-        if (iac == 0 && ch == 0xff) {
-            // Enable IAC mode
-            iac++;
-            continue;
-        }
+    const uint8_t *span{};
+    size_t size;
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_RX
+    // Parse the input in place and release every packet as soon as it is processed
+    while (cmd == nullptr && (size = rxQueue.getReadSpan(span)) > 0) {
+        const auto consumed = processInput(span, size);
+        rxQueue.consume(consumed);
+        if (consumed < size) break;
+    }
+#else
+    while (cmd == nullptr && (size = getRxBuffer()->available()) > 0) {
+        span = getRxBuffer()->getReadPointer();
+        const auto consumed = processInput(span, size);
+        getRxBuffer()->remove(consumed);
+        if (consumed < size) break;
+    }
+#endif
+}
 
-        if (iac == 1 && ch == 0xff) {
-            // Second IAC marks a real 0xff byte
-            iac = 0;
-        }
+ULONG LogicalConnectionMicrorl::telnetDecode(NX_PACKET *packet) {
+    if (raw) return packet->nx_packet_length;
+
+    ULONG length = 0;
+    for (auto segment = packet; segment != nullptr;) {
+        const auto size = static_cast<size_t>(segment->nx_packet_append_ptr - segment->nx_packet_prepend_ptr);
+        const auto decoded = telnetCodec.decode(segment->nx_packet_prepend_ptr, size, *this);
+        segment->nx_packet_append_ptr = segment->nx_packet_prepend_ptr + decoded;
+        length += decoded;
+#ifndef NX_DISABLE_PACKET_CHAIN
+        segment = segment->nx_packet_next;
+#else
+        segment = nullptr;
+#endif
+    }
+    packet->nx_packet_length = length;
+
+    // The replies stay queued, the server sends them together when it processes the session
+    return length;
+}
+
+void LogicalConnectionMicrorl::telnetOption(uint8_t verb, uint8_t option) {
+    // Server::receive_data() holds the session mutex
+    telnetOptions.receive(verb, option, *this);
+}
 
-        if (iac > 0) {
-            // 1 byte commands
-            if (iac == 1 && ch >= 0xf0 && ch <= 0xf9) {
-                iacCmd = ch;
-                iac = 0;
-                iacCmd = 0;
+void LogicalConnectionMicrorl::telnetSubnegotiation(uint8_t option, const uint8_t *data, size_t size) {
+    switch (option) {
+        case TelnetOptions::OPTION_NAWS:
+            if (size == 4) {
+                windowWidth = static_cast<uint16_t>(data[0] << 8 | data[1]);
+                windowHeight = static_cast<uint16_t>(data[2] << 8 | data[3]);
             }
+            break;
 
-            // 2 byte commands
-            if (iac == 1 && ch >= 0xfb && ch <= 0xfe) {
-                iacCmd = ch;
-                iac++;
+        case TelnetOptions::OPTION_TTYPE:
+            if (size > 0 && data[0] == TelnetOptions::TTYPE_IS) {
+                const auto length = size - 1 < sizeof(terminalType) - 1 ? size - 1 : sizeof(terminalType) - 1;
+                memcpy(terminalType, data + 1, length);
+                terminalType[length] = '\0';
             }
-            if (iac == 2 && iacCmd >= 0xfb && iacCmd <= 0xfe) {
-                iac = 0;
-                iacCmd = 0;
+            break;
+
+        case TelnetOptions::OPTION_LINEMODE:
+            if (size < 2 || !telnetOptions.isEnabled(TelnetOptions::Side::REMOTE, option)) break;
+            if (data[0] == TelnetOptions::LINEMODE_MODE) {
+                if ((data[1] & TelnetOptions::MODE_ACK) == 0) {
+                    // A mode proposed by the client is accepted as it is
+                    const uint8_t mode[] = {TelnetOptions::LINEMODE_MODE,
+                                            static_cast<uint8_t>(data[1] | TelnetOptions::MODE_ACK)};
+                    sendSubnegotiation(option, mode, sizeof(mode));
+                }
+                setLineEdit((data[1] & TelnetOptions::MODE_EDIT) != 0);
+            } else if ((data[0] == TelnetCodec::DO || data[0] == TelnetCodec::WILL)
+                       && data[1] == TelnetOptions::LINEMODE_FORWARDMASK) {
+                // No forward mask, the client forwards whole lines
+                const uint8_t refusal[] = {data[0] == TelnetCodec::DO ? TelnetCodec::WONT : TelnetCodec::DONT,
+                                           TelnetOptions::LINEMODE_FORWARDMASK};
+                sendSubnegotiation(option, refusal, sizeof(refusal));
             }
+            // Special line characters (SLC) are left at the defaults of the client
+            break;
+
+        default:
+            break;
+    }
+}
+
+bool LogicalConnectionMicrorl::telnetAccept(TelnetOptions::Side side, uint8_t option) {
+    if (side == TelnetOptions::Side::LOCAL) {
+        switch (option) {
+            case TelnetOptions::OPTION_ECHO:
+                // microrl echoes, unless the client edits locally
+                return !lineEdit;
+            case TelnetOptions::OPTION_SGA:
+                return true;
+            case TelnetOptions::OPTION_BINARY:
+                return binaryConsumer != nullptr;
+            default:
+                return false;
+        }
+    }
+    switch (option) {
+        case TelnetOptions::OPTION_SGA:
+        case TelnetOptions::OPTION_NAWS:
+        case TelnetOptions::OPTION_TTYPE:
+            return true;
+        case TelnetOptions::OPTION_BINARY:
+            return binaryConsumer != nullptr;
+        case TelnetOptions::OPTION_LINEMODE:
+            return linemodeWanted;
+        default:
+            return false;
+    }
+}
 
-            // multi byte commands
-            if (iac == 1 && ch == 0xfa) {
-                iacCmd = ch;
-                iac++;
+void LogicalConnectionMicrorl::telnetChanged(TelnetOptions::Side side, uint8_t option, bool enabled) {
+    if (side != TelnetOptions::Side::REMOTE) return;
+    switch (option) {
+        case TelnetOptions::OPTION_BINARY:
+            telnetCodec.setBinary(enabled);
+            break;
+        case TelnetOptions::OPTION_TTYPE:
+            if (enabled) {
+                const uint8_t send[] = {TelnetOptions::TTYPE_SEND};
+                sendSubnegotiation(option, send, sizeof(send));
             }
-            // multi byte commands end
-            if (iac > 2 && ch == 0xf0) {
-                iac = 0;
-                iacCmd = 0;
+            break;
+        case TelnetOptions::OPTION_LINEMODE:
+            if (enabled) {
+                // Let the client edit locally, signals stay with the server
+                const uint8_t mode[] = {TelnetOptions::LINEMODE_MODE, TelnetOptions::MODE_EDIT};
+                sendSubnegotiation(option, mode, sizeof(mode));
+            } else {
+                setLineEdit(false);
             }
+            break;
+        default:
+            break;
+    }
+}
+
+void LogicalConnectionMicrorl::telnetSend(uint8_t verb, uint8_t option) {
+    const uint8_t message[] = {TelnetCodec::IAC, verb, option};
+    queueNegotiation(message, sizeof(message));
+}
+
+void LogicalConnectionMicrorl::sendSubnegotiation(uint8_t option, const uint8_t *data, size_t size) {
+    const uint8_t begin[] = {TelnetCodec::IAC, TelnetCodec::SB, option};
+    const uint8_t end[] = {TelnetCodec::IAC, TelnetCodec::SE};
+    queueNegotiation(begin, sizeof(begin));
+    queueNegotiation(data, size);
+    queueNegotiation(end, sizeof(end));
+}
+
+void LogicalConnectionMicrorl::queueNegotiation(const uint8_t *data, size_t size) {
+    // The buffer holds the replies to a burst of commands, more is refused like an unknown option
+    if (size > sizeof(negotiation) - negotiationLength) return;
+    memcpy(negotiation + negotiationLength, data, size);
+    negotiationLength += size;
+}
+
+void LogicalConnectionMicrorl::flushNegotiation() {
+    // Server::loop() holds the session mutex, so no reply is queued meanwhile
+    const auto size = negotiationLength;
+    if (size == 0) return;
+
+    // The replies are telnet commands, so they bypass the IAC escaping of the output
+    size_t sent = 0;
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_TX
+    uint8_t *buffer{};
+    sent = txPacket.getWriteBuffer(buffer);
+    if (sent > size) sent = size;
+    if (sent > 0) {
+        memcpy(buffer, negotiation, sent);
+        txPacket.setWrittenBytes(sent);
+    }
+#elif defined(LIBSMART_STM32NETXTELNET_TX_RING)
+    // The ring holds unescaped output, the replies follow the output committed before in a packet of their own
+    if (txRing.available() > 0) {
+        // Let the output ahead of the replies go out without delay
+        txFlush = true;
+    } else if (server != nullptr && txPendingPacket == nullptr
+               && server->packetCreate(txPendingPacket, negotiation, size, NX_NO_WAIT) == NX_SUCCESS) {
+        sent = size;
+    }
+#else
+    sent = getTxBuffer()->getRemainingSpace();
+    if (sent > size) sent = size;
+    memcpy(getTxBuffer()->getWritePointer(), negotiation, sent);
+    getTxBuffer()->setWrittenBytes(sent);
+#endif
+    if (sent == 0) return;
+
+    // Replies, that did not fit, stay for the next call
+    memmove(negotiation, negotiation + sent, negotiationLength - sent);
+    negotiationLength -= sent;
+    txFlush = true;
+}
+
+void LogicalConnectionMicrorl::setLineEdit(bool enable) {
+    if (enable == lineEdit) return;
+    lineEdit = enable;
+    telnetOptions.request(TelnetOptions::Side::LOCAL, TelnetOptions::OPTION_ECHO, !enable, *this);
+}
+
+void LogicalConnectionMicrorl::setBinaryMode(Stm32Common::Stream *consumer) {
+    const auto srv = server;
+    if (srv == nullptr) {
+        // Without a connection there is nothing to negotiate
+        binaryConsumer = consumer;
+        return;
+    }
+
+    // Commands call this from the worker thread, the telnet server thread negotiates under the same mutex
+    Server::SessionLock lock(&srv->sessionMutex);
+    binaryConsumer = consumer;
+    const bool enable = consumer != nullptr;
+    telnetOptions.request(TelnetOptions::Side::LOCAL, TelnetOptions::OPTION_BINARY, enable, *this);
+    telnetOptions.request(TelnetOptions::Side::REMOTE, TelnetOptions::OPTION_BINARY, enable, *this);
+
+    // The server loop sends the requests.
+    // Input waiting for microrl goes to the consumer now and vice versa
+    srv->notify(Server::Event::RX);
+}
+
+size_t LogicalConnectionMicrorl::processInput(const uint8_t *data, size_t size) {
+    if (binaryConsumer != nullptr) {
+        // Binary data bypasses the line editor
+        return binaryConsumer->write(data, size);
+    }
+    if (raw || lineEdit) {
+        return processLines(data, size);
+    }
+
+    size_t i = 0;
+    while (i < size) {
+        // Plain characters go to microrl in one call, together with a trailing control character
+        auto run = scanPlain(data + i, size - i);
+        if (i + run < size) {
+            run++;
+        }
+        processMicrorl(data + i, run);
+        i += run;
+
+        // A completed line may have started a command, the rest of the input waits for it
+        if (cmd != nullptr) break;
+    }
+    return i;
+}
+
+size_t LogicalConnectionMicrorl::processLines(const uint8_t *data, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        // Copy plain characters in one go, the last byte of the line buffer is kept for the terminator
+        const auto run = scanPlain(data + i, size - i);
+        auto room = sizeof(lineBuffer) - 1 - lineLength;
+        if (run > room) {
+            lineOverflow = true;
         } else {
-            // Send character to microrl, if not in IAC mode
-            auto ret = microrl_processing_input(this, &ch, 1);
-            if (ret != microrlOK) {
-                log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
-                        ->printf("microrl_processing_input() = 0x%02x\r\n", ret);
+            room = run;
+        }
+        memcpy(lineBuffer + lineLength, data + i, room);
+        lineLength += room;
+        i += run;
+        if (i >= size) break;
+
+        const auto ch = data[i++];
+        if (ch != '\r' && ch != '\n') {
+            if (lineLength < sizeof(lineBuffer) - 1) {
+                lineBuffer[lineLength++] = static_cast<char>(ch);
+            } else {
+                lineOverflow = true;
             }
+            continue;
+        }
+
+        if (lineOverflow) {
+            println("ERROR: LINE TOO LONG");
+        } else if (lineLength > 0) {
+            execLine();
+        }
+        lineLength = 0;
+        lineOverflow = false;
+
+        // The rest of the input waits for the command
+        if (cmd != nullptr) break;
+    }
+    return i;
+}
+
+void LogicalConnectionMicrorl::execLine() {
+    const char *argv[LIBSMART_STM32NETXTELNET_LINE_MAX_TOKENS]{};
+    int argc = 0;
+    lineBuffer[lineLength] = '\0';
+    for (auto p = lineBuffer; *p != '\0';) {
+        if (*p == ' ' || *p == '\t') {
+            *p++ = '\0';
+            continue;
+        }
+        if (argc == LIBSMART_STM32NETXTELNET_LINE_MAX_TOKENS) {
+            println("ERROR: TOO MANY TOKENS");
+            return;
         }
+        argv[argc++] = p;
+        while (*p != '\0' && *p != ' ' && *p != '\t') p++;
+    }
+    if (argc > 0) {
+        microrlExec(this, argc, argv);
+    }
+}
+
+size_t LogicalConnectionMicrorl::escapeOutput(uint8_t *data, size_t size, size_t space, size_t &escaped) const {
+    if (raw) {
+        escaped = size < space ? size : space;
+        return escaped;
+    }
+    return TelnetCodec::encode(data, size, space, escaped);
+}
+
+size_t LogicalConnectionMicrorl::scanPlain(const uint8_t *data, size_t size) {
+    size_t i = 0;
+
+    // Check 4 bytes at once for a control character (< 0x20)
+    for (; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t)) {
+        uint32_t word;
+        memcpy(&word, data + i, sizeof(word));
+        if (((word - 0x20202020u) & ~word & 0x80808080u) != 0) break;
+    }
+
+    // Locate the control character inside the word or check the tail
+    for (; i < size; i++) {
+        if (data[i] < 0x20) break;
+    }
+    return i;
+}
+
+void LogicalConnectionMicrorl::processMicrorl(const uint8_t *data, size_t size) {
+    auto ret = microrl_processing_input(this, data, size);
+    if (ret != microrlOK) {
+        log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
+                ->printf("microrl_processing_input() = 0x%02x\r\n", ret);
     }
 }
 
@@ -191,6 +735,17 @@ void LogicalConnectionMicrorl::end() {
     // isConnectionActive = false;
     getRxBuffer()->clear();
     getTxBuffer()->clear();
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_TX
+    txPacket.clear();
+#endif
+#ifdef LIBSMART_STM32NETXTELNET_TX_RING
+    txRing.clear();
+#endif
+    if (txPendingPacket != nullptr) {
+        nx_packet_release(txPendingPacket);
+        txPendingPacket = nullptr;
+    }
+    rxQueue.clear();
     if (cmd != nullptr) {
         auto cmdCtx = cmd->getCommandContext();
         Stm32GcodeRunner::WorkerDynamic::terminateCommandContext(cmdCtx);
@@ -199,6 +754,23 @@ void LogicalConnectionMicrorl::end() {
     // isConnectionActive = false;
     microrl_t{};
     cmd = nullptr;
-    iac = 0;
-    iacCmd = 0;
+    server = nullptr;
+    subscribed = true;
+    txNotified = false;
+    txFlush = false;
+    txEcho = false;
+    txPending = false;
+    telnetCodec.reset();
+    telnetOptions.reset();
+    negotiationLength = 0;
+    windowWidth = 0;
+    windowHeight = 0;
+    terminalType[0] = '\0';
+    raw = false;
+    linemodeWanted = false;
+    lineEdit = false;
+    greetingPending = false;
+    lineLength = 0;
+    lineOverflow = false;
+    binaryConsumer = nullptr;
 }
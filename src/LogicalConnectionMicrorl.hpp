@@ -12,6 +12,23 @@
 #include "Loggable.hpp"
 #include "Nameable.hpp"
 #include "StreamRxTx.hpp"
+#include "CoalescingPolicy.hpp"
+#include "RxQueue.hpp"
+#include "TelnetCodec.hpp"
+#include "TelnetOptions.hpp"
+#include "TxPacket.hpp"
+#include "TxRing.hpp"
+
+#if defined(LIBSMART_STM32NETXTELNET_ZERO_COPY_TX) && defined(LIBSMART_STM32NETXTELNET_TX_RING)
+#error "LIBSMART_STM32NETXTELNET_ZERO_COPY_TX and LIBSMART_STM32NETXTELNET_TX_RING can not be used together"
+#endif
+
+#if defined(LIBSMART_STM32NETXTELNET_ZERO_COPY_TX) || defined(LIBSMART_STM32NETXTELNET_TX_RING)
+// The output bypasses the tx buffer of StreamRxTx, so it is kept at the minimum
+#define LIBSMART_STM32NETXTELNET_STREAM_BUFFER_SIZE_TX 1
+#else
+#define LIBSMART_STM32NETXTELNET_STREAM_BUFFER_SIZE_TX LIBSMART_STM32NETXTELNET_BUFFER_SIZE_TX
+#endif
 
 namespace Stm32NetXTelnet {
 
@@ -21,7 +38,9 @@ namespace Stm32NetXTelnet {
                                      public Stm32Common::StreamSession::StreamSessionInterface,
                                      public Stm32Common::StreamRxTx<
                                          LIBSMART_STM32NETXTELNET_BUFFER_SIZE_RX,
-                                         LIBSMART_STM32NETXTELNET_BUFFER_SIZE_TX> {
+                                         LIBSMART_STM32NETXTELNET_STREAM_BUFFER_SIZE_TX>,
+                                     private TelnetCodec::Handler,
+                                     private TelnetOptions::Handler {
     public:
         friend Server;
 
@@ -40,6 +59,110 @@ namespace Stm32NetXTelnet {
          */
         void flush() override;
 
+        /**
+         * @brief Returns a pointer to the free space of the output buffer.
+         *
+         * Depending on LIBSMART_STM32NETXTELNET_ZERO_COPY_TX and LIBSMART_STM32NETXTELNET_TX_RING, this
+         * is either the tx buffer, the payload of the pre-allocated transmit packet or a span of the tx ring.
+         * A span of the tx ring blocks all other writers, they wait until it is committed with setWrittenBytes().
+         * The transmit packet is locked with the session mutex of the server until setWrittenBytes(), so the
+         * server does not send it while it is written.
+         *
+         * @param buffer Reference to a pointer which is set to the first free byte.
+         *
+         * @return Number of bytes that can be written to buffer.
+         */
+        size_t getWriteBuffer(uint8_t *&buffer) override;
+
+        /**
+         * @brief Commits bytes written to the buffer returned by getWriteBuffer().
+         *
+         * IAC bytes are doubled in place, bytes that do not fit into the buffer afterwards are dropped.
+         * The tx ring keeps the output as it is, it is escaped when the server sends it.
+         *
+         * @param size Number of bytes written.
+         *
+         * @return Number of written bytes added to the output buffer.
+         */
+        size_t setWrittenBytes(size_t size) override;
+
+        using Stm32Common::StreamRxTx<LIBSMART_STM32NETXTELNET_BUFFER_SIZE_RX,
+            LIBSMART_STM32NETXTELNET_STREAM_BUFFER_SIZE_TX>::write;
+
+        size_t write(uint8_t data) override;
+
+        size_t write(const uint8_t *buffer, size_t size) override;
+
+#if defined(LIBSMART_STM32NETXTELNET_ZERO_COPY_TX) || defined(LIBSMART_STM32NETXTELNET_TX_RING)
+        int availableForWrite() override;
+#endif
+
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_RX
+        int available() override;
+
+        int read() override;
+
+        int peek() override;
+#endif
+
+        /**
+         * @brief Sets the rules for coalescing small writes of this session.
+         *
+         * @param policy The coalescing policy.
+         */
+        void setCoalescing(const CoalescingPolicy &policy) { coalescing = policy; }
+
+        /**
+         * @brief Subscribes to or unsubscribes from the broadcasts of the server.
+         *
+         * @param enable true to receive broadcasts, which is the default of a new session.
+         */
+        void subscribe(bool enable) { subscribed = enable; }
+
+        /**
+         * @brief Returns true, if the session receives broadcasts of the server.
+         */
+        bool isSubscribed() const { return subscribed; }
+
+        /**
+         * @brief Switches the session to binary transmission (RFC 856) or back to line editing.
+         *
+         * Asks the client for binary mode in both directions. From then on input bypasses microrl and
+         * is written to the consumer as it is, output is only modified by doubling IAC bytes.
+         * May be called from any thread, e.g. by a command.
+         *
+         * @param consumer The stream, that receives the input, or nullptr to return to line editing.
+         */
+        void setBinaryMode(Stm32Common::Stream *consumer);
+
+        /**
+         * @brief Returns true, if the client agreed to binary transmission in both directions.
+         */
+        bool isBinary() const {
+            return telnetOptions.isEnabled(TelnetOptions::Side::LOCAL, TelnetOptions::OPTION_BINARY)
+                   && telnetOptions.isEnabled(TelnetOptions::Side::REMOTE, TelnetOptions::OPTION_BINARY);
+        }
+
+        /**
+         * @brief Returns the width of the terminal window reported by the client (NAWS), 0 if unknown.
+         */
+        uint16_t getWindowWidth() const { return windowWidth; }
+
+        /**
+         * @brief Returns the height of the terminal window reported by the client (NAWS), 0 if unknown.
+         */
+        uint16_t getWindowHeight() const { return windowHeight; }
+
+        /**
+         * @brief Returns the terminal type reported by the client (TTYPE), an empty string if unknown.
+         */
+        const char *getTerminalType() const { return terminalType; }
+
+        /**
+         * @brief Returns true, if the session belongs to a server in raw TCP mode.
+         */
+        bool isRaw() const { return raw; }
+
         int microrlOutput(microrl *mrl, const char *str);
 
         int microrlExec(microrl *mrl, int argc, const char *const *argv);
@@ -55,10 +178,194 @@ namespace Stm32NetXTelnet {
         void end() override;
 
     private:
+        /**
+         * @brief Tells the server, that there is output to send.
+         *
+         * The server is only notified once until it has picked up the output.
+         */
+        void notifyTx();
+
+        /**
+         * @brief Writes the banner and the first prompt of a new session.
+         */
+        void greet();
+
+        /**
+         * @brief Removes the telnet commands from a received packet and handles them.
+         *
+         * Called by the telnet server thread, before the packet is queued. Commands may be split
+         * across packets, as the codec keeps its state. The replies are only queued, the server
+         * sends them when it processes the session next.
+         *
+         * @param packet The received packet, whose payload is replaced with the plain data.
+         *
+         * @return Number of plain data bytes left in the packet.
+         */
+        ULONG telnetDecode(NX_PACKET *packet);
+
+        void telnetOption(uint8_t verb, uint8_t option) override;
+
+        void telnetSubnegotiation(uint8_t option, const uint8_t *data, size_t size) override;
+
+        bool telnetAccept(TelnetOptions::Side side, uint8_t option) override;
+
+        void telnetChanged(TelnetOptions::Side side, uint8_t option, bool enabled) override;
+
+        void telnetSend(uint8_t verb, uint8_t option) override;
+
+        /**
+         * @brief Queues a subnegotiation (IAC SB option data IAC SE) for the client.
+         *
+         * @param option The option code.
+         * @param data A pointer to the parameters, which must not contain IAC.
+         * @param size The number of parameter bytes.
+         */
+        void sendSubnegotiation(uint8_t option, const uint8_t *data, size_t size);
+
+        /**
+         * @brief Appends negotiation bytes to the buffer, that is sent by flushNegotiation().
+         *
+         * The buffer is guarded by the session mutex of the server, which the caller holds.
+         *
+         * @param data A pointer to the bytes.
+         * @param size The number of bytes.
+         */
+        void queueNegotiation(const uint8_t *data, size_t size);
+
+        /**
+         * @brief Moves the queued negotiation into the output of the session and flushes it.
+         *
+         * Called by the server, when it processes the session. The negotiation follows the output
+         * written before. What does not fit into the output stays queued for the next call.
+         */
+        void flushNegotiation();
+
+        /**
+         * @brief Switches between local editing by the client and editing with microrl.
+         *
+         * The client echoes its input itself, while it edits locally.
+         *
+         * @param enable true, if the client edits locally and sends whole lines.
+         */
+        void setLineEdit(bool enable);
+
+        /**
+         * @brief Handles a block of input, that is free of telnet commands.
+         *
+         * Runs of plain characters are passed to microrl in one call, together with a trailing
+         * control character. Processing stops after a line, that started a command.
+         * In binary mode the input goes to the binary consumer instead, with local editing by the
+         * client to processLines().
+         *
+         * @param data A pointer to the input.
+         * @param size The number of input bytes.
+         *
+         * @return Number of bytes processed.
+         */
+        size_t processInput(const uint8_t *data, size_t size);
+
+        /**
+         * @brief Handles a block of input, that the client has edited already.
+         *
+         * Used by raw sessions and by clients in LINEMODE. Collects the input into lines without echo
+         * and passes every complete line to the command parser. Processing stops after a line, that
+         * started a command.
+         *
+         * @param data A pointer to the input.
+         * @param size The number of input bytes.
+         *
+         * @return Number of bytes processed.
+         */
+        size_t processLines(const uint8_t *data, size_t size);
+
+        /**
+         * @brief Splits the collected input line into tokens and executes it.
+         */
+        void execLine();
+
+        /**
+         * @brief Doubles the IAC bytes of output written in place, unless the session is raw.
+         *
+         * @param data A pointer to the output.
+         * @param size The number of output bytes.
+         * @param space The number of bytes available at data.
+         * @param escaped Reference to the number of bytes at data after escaping.
+         *
+         * @return Number of output bytes accepted.
+         */
+        size_t escapeOutput(uint8_t *data, size_t size, size_t space, size_t &escaped) const;
+
+        /**
+         * @brief Returns the number of leading bytes, that are no control characters.
+         *
+         * Scans a word at a time.
+         *
+         * @param data A pointer to the input.
+         * @param size The number of input bytes.
+         *
+         * @return Length of the run of plain characters.
+         */
+        static size_t scanPlain(const uint8_t *data, size_t size);
+
+        /**
+         * @brief Passes characters to microrl.
+         *
+         * @param data A pointer to the characters.
+         * @param size The number of characters.
+         */
+        void processMicrorl(const uint8_t *data, size_t size);
+
+        /**
+         * @brief Checks, if the command running in this session belongs to a command context.
+         *
+         * The callbacks of a command run in the worker thread and may still come, after the connection
+         * has ended and the session serves the next connection.
+         *
+         * @param cmdCtx The command context of the callback.
+         *
+         * @return true if the context is the one of the running command.
+         */
+        bool isCommandContext(const Stm32GcodeRunner::CommandContext *cmdCtx) const {
+            return cmd != nullptr && cmd->getCommandContext() == cmdCtx;
+        }
+
+        Server *server{};
+        volatile bool txNotified = false;
+        volatile bool txFlush = false;
+        bool txEcho = false;
+        bool txPending = false;
+        ULONG txPendingSince{};
+        NX_PACKET *txPendingPacket{};
+        RxQueue rxQueue{};
+        CoalescingPolicy coalescing{};
+        bool subscribed = true;
         // bool isConnectionActive = false;
         Stm32GcodeRunner::AbstractCommand *cmd{};
-        uint8_t iac = 0;
-        uint8_t iacCmd = 0;
+        bool raw = false;
+        bool linemodeWanted = false;
+        volatile bool lineEdit = false;
+        bool greetingPending = false;
+        char lineBuffer[LIBSMART_STM32NETXTELNET_LINE_SIZE]{};
+        size_t lineLength{};
+        bool lineOverflow = false;
+        TelnetCodec telnetCodec{};
+        TelnetOptions telnetOptions{};
+        uint8_t negotiation[LIBSMART_STM32NETXTELNET_NEGOTIATION_BUFFER_SIZE]{};
+        size_t negotiationLength{};
+        uint16_t windowWidth{};
+        uint16_t windowHeight{};
+        char terminalType[LIBSMART_STM32NETXTELNET_SB_BUFFER_SIZE]{};
+        Stm32Common::Stream *binaryConsumer{};
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_TX
+        TxPacket txPacket{};
+        TX_MUTEX *txPacketLock{};
+#endif
+#ifdef LIBSMART_STM32NETXTELNET_TX_RING
+        TxRing<LIBSMART_STM32NETXTELNET_BUFFER_SIZE_TX> txRing{};
+        TX_THREAD *txRingOwner{};
+        size_t txRingReserved{};
+        TX_MUTEX txRingMutex{};
+#endif
 
     protected:
         template<class T, class Method, Method m, class... Params>
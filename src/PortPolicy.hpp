@@ -0,0 +1,28 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBSMART_STM32NETXTELNET_PORTPOLICY_HPP
+#define LIBSMART_STM32NETXTELNET_PORTPOLICY_HPP
+
+#include "CoalescingPolicy.hpp"
+
+namespace Stm32NetXTelnet {
+    /**
+     * @brief Settings of the sessions, that connect to one TCP port of a server.
+     *
+     * A server listening on several ports, e.g. a telnet console and a raw port for automated tools,
+     * applies the policy of the port to every new session.
+     */
+    struct PortPolicy {
+        /** Skip the telnet option exchange, IAC processing, echo and banner. */
+        bool raw = false;
+        /** Offer LINEMODE (RFC 1184) to the client. */
+        bool linemode = true;
+        /** Rules for coalescing small writes. */
+        CoalescingPolicy coalescing{};
+    };
+}
+
+#endif
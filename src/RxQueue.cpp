@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "RxQueue.hpp"
+
+bool Stm32NetXTelnet::RxQueue::push(NX_PACKET *packet) {
+    const auto h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH) {
+        return false;
+    }
+    packets[h % LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH] = packet;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+bool Stm32NetXTelnet::RxQueue::isFull() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)
+           >= LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH;
+}
+
+size_t Stm32NetXTelnet::RxQueue::getReadSpan(const uint8_t *&span) {
+    span = nullptr;
+    const auto t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    auto packet = packets[t % LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH];
+    ULONG skip = offset;
+#ifndef NX_DISABLE_PACKET_CHAIN
+    // Find the packet of the chain, that holds the read position
+    while (packet->nx_packet_next != nullptr
+           && skip >= static_cast<ULONG>(packet->nx_packet_append_ptr - packet->nx_packet_prepend_ptr)) {
+        skip -= packet->nx_packet_append_ptr - packet->nx_packet_prepend_ptr;
+        packet = packet->nx_packet_next;
+    }
+#endif
+    const ULONG size = packet->nx_packet_append_ptr - packet->nx_packet_prepend_ptr;
+    if (skip >= size) {
+        return 0;
+    }
+    span = packet->nx_packet_prepend_ptr + skip;
+    return size - skip;
+}
+
+void Stm32NetXTelnet::RxQueue::consume(size_t size) {
+    offset += size;
+    auto t = tail.load(std::memory_order_relaxed);
+    while (t != head.load(std::memory_order_acquire)) {
+        auto &packet = packets[t % LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH];
+        if (offset < packet->nx_packet_length) {
+            break;
+        }
+        offset -= packet->nx_packet_length;
+        nx_packet_release(packet);
+        packet = nullptr;
+        tail.store(++t, std::memory_order_release);
+    }
+    if (t == head.load(std::memory_order_acquire)) {
+        offset = 0;
+    }
+}
+
+size_t Stm32NetXTelnet::RxQueue::available() const {
+    size_t size = 0;
+    const auto h = head.load(std::memory_order_acquire);
+    for (auto t = tail.load(std::memory_order_relaxed); t != h; t++) {
+        size += packets[t % LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH]->nx_packet_length;
+    }
+    return size > offset ? size - offset : 0;
+}
+
+void Stm32NetXTelnet::RxQueue::clear() {
+    auto t = tail.load(std::memory_order_relaxed);
+    while (t != head.load(std::memory_order_acquire)) {
+        auto &packet = packets[t % LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH];
+        nx_packet_release(packet);
+        packet = nullptr;
+        tail.store(++t, std::memory_order_release);
+    }
+    offset = 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBSMART_STM32NETXTELNET_RXQUEUE_HPP
+#define LIBSMART_STM32NETXTELNET_RXQUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <libsmart_config.hpp>
+#include "nx_api.h"
+
+namespace Stm32NetXTelnet {
+    /**
+     * @brief Queue of received packets, whose payload is read in place.
+     *
+     * The telnet server thread pushes packets, the server loop reads their payload as spans and
+     * releases every packet as soon as it is consumed completely.
+     */
+    class RxQueue {
+        static_assert((LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH & (LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH - 1)) == 0,
+                      "LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH must be a power of 2");
+
+    public:
+        ~RxQueue() { clear(); }
+
+        /**
+         * @brief Appends a received packet. Producer only.
+         *
+         * @param packet The packet, which is owned by the queue from now on.
+         *
+         * @return true on success, false if the queue is full and the packet still belongs to the caller.
+         */
+        bool push(NX_PACKET *packet);
+
+        /**
+         * @brief Returns true, if no more packets can be pushed.
+         */
+        bool isFull() const;
+
+        /**
+         * @brief Returns the unread payload bytes at the read position, that are contiguous in memory. Consumer only.
+         *
+         * @param span Reference to a pointer which is set to the first unread byte.
+         *
+         * @return Number of bytes at span, 0 if the queue is empty.
+         */
+        size_t getReadSpan(const uint8_t *&span);
+
+        /**
+         * @brief Marks bytes as read and releases all packets that are read completely. Consumer only.
+         *
+         * @param size Number of bytes read.
+         */
+        void consume(size_t size);
+
+        /**
+         * @brief Returns the number of unread payload bytes in all packets. Consumer only.
+         */
+        size_t available() const;
+
+        /**
+         * @brief Releases all packets. Consumer only.
+         */
+        void clear();
+
+    private:
+        NX_PACKET *packets[LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH]{};
+        std::atomic<uint32_t> head{0};
+        std::atomic<uint32_t> tail{0};
+        ULONG offset{};
+    };
+}
+
+#endif
@@ -4,7 +4,9 @@
  */
 
 #include "Server.hpp"
+#include <cstring>
 #include "LogicalConnection.hpp"
+#include "LogicalConnectionMicrorl.hpp"
 #include "Stm32NetX.hpp"
 #include "StreamRxTx.hpp"
 
@@ -15,21 +17,61 @@ UINT Stm32NetXTelnet::Server::create(CHAR *server_name, NX_IP *ip_ptr, void *sta
     log(Stm32ItmLogger::LoggerInterface::Severity::INFORMATIONAL)
             ->println("Stm32NetXTelnet::Server::create()");
 
+    auto ret = tx_event_flags_create(&serverEvents, server_name);
+    if (ret != TX_SUCCESS) {
+        log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
+                ->printf("tx_event_flags_create() = 0x%02x\r\n", ret);
+        return ret;
+    }
+
+    // The telnet server thread and the thread calling await() share the sessions
+    ret = tx_mutex_create(&sessionMutex, server_name, TX_INHERIT);
+    if (ret != TX_SUCCESS) {
+        log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
+                ->printf("tx_mutex_create() = 0x%02x\r\n", ret);
+        tx_event_flags_delete(&serverEvents);
+        return ret;
+    }
+
+    auto clients = clientList;
+#ifndef NX_TELNET_SERVER_USER_CLIENT_LIST
+    if (clients == nullptr) {
+        clients = nx_telnet_server_client_area;
+    }
+#endif
+
     // https://github.com/eclipse-threadx/rtos-docs/blob/main/rtos-docs/netx-duo/netx-duo-telnet/chapter3.md#nx_telnet_server_create
-    const auto ret = nx_telnet_server_create(
+    ret = nx_telnet_server_create_extended(
         this,
         server_name,
         ip_ptr,
         stack_ptr,
         stack_size,
+        clients,
+        maxClients,
+        windowSize,
         new_connection,
         receive_data,
         connection_end
     );
     if (ret != NX_SUCCESS) {
         log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
-                ->printf("nx_telnet_server_create() = 0x%02x\r\n", ret);
+                ->printf("nx_telnet_server_create_extended() = 0x%02x\r\n", ret);
+        tx_mutex_delete(&sessionMutex);
+        tx_event_flags_delete(&serverEvents);
+        return ret;
+    }
+
+    // Telnet commands are parsed and negotiated by the sessions, wherever they appear in the data stream
+    nx_telnet_server_raw_receive = NX_TRUE;
+    nx_telnet_server_option_requests_disable = NX_TRUE;
+
+#ifdef NX_ENABLE_TCP_QUEUE_DEPTH_UPDATE_NOTIFY
+    // Get woken up, when a socket with a full transmit queue can take data again
+    for (UINT i = 0; i < nx_telnet_server_max_clients; i++) {
+        nx_tcp_socket_queue_depth_notify_set(getSocket(i), queueDepthNotify);
     }
+#endif
     return ret;
 }
 
@@ -51,14 +93,34 @@ void Stm32NetXTelnet::Server::new_connection(NX_TELNET_SERVER_STRUCT *telnet_ser
 
     LIBSMART_UNUSED(telnet_server_ptr);
 
+    SessionLock lock(&sessionMutex);
+    nx_telnet_server_client_list[logical_connection].nx_telnet_client_request_receive_paused = NX_FALSE;
+    const auto &policy = policies[nx_telnet_server_client_list[logical_connection].nx_telnet_client_request_listener];
+
     auto session = getSessionManager()->getNewSession(logical_connection);
-    if (session != nullptr) {
+    if (session == nullptr && admissionPolicy == AdmissionPolicy::EVICT_IDLE && evictIdle(logical_connection)) {
+        session = getSessionManager()->getNewSession(logical_connection);
+    }
+    if (session == nullptr) {
+        reject(logical_connection);
+    } else {
         char name[25]{};
         snprintf(name, sizeof(name), "Telnet Session %d", logical_connection);
         session->setName(name);
         session->setLogger(getLogger());
+        getTelnetSession(session)->server = this;
+        getTelnetSession(session)->raw = policy.raw;
+        getTelnetSession(session)->linemodeWanted = policy.linemode;
+        getTelnetSession(session)->setCoalescing(policy.coalescing);
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_TX
+        // Never fill a transmit packet beyond what the peer accepts in one segment
+        getTelnetSession(session)->txPacket.setPacketPool(getTxPacketPool());
+        getTelnetSession(session)->txPacket.setMaxPayload(
+            nx_telnet_server_client_list[logical_connection].nx_telnet_client_request_socket.nx_tcp_socket_connect_mss);
+#endif
         session->setup();
     }
+    notify(Event::SESSION);
 }
 
 void Stm32NetXTelnet::Server::receive_data(NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection,
@@ -68,19 +130,34 @@ void Stm32NetXTelnet::Server::receive_data(NX_TELNET_SERVER_STRUCT *telnet_serve
 
     LIBSMART_UNUSED(telnet_server_ptr);
 
+    SessionLock lock(&sessionMutex);
     auto session = getSessionManager()->getSessionById(logical_connection);
-    if(session != nullptr) {
-        ULONG length = 0;
-        ULONG bytes_copied = 0;
-        nx_packet_length_get(packet_ptr, &length);
-        if (length <= session->getRxBuffer()->availableForWrite()) {
-            auto ret = nx_packet_data_retrieve(packet_ptr, session->getRxBuffer()->getWritePointer(), &bytes_copied);
-            if (ret == NX_SUCCESS) {
-                session->getRxBuffer()->setWrittenBytes(bytes_copied);
-            }
+    if (session == nullptr) {
+        nx_packet_release(packet_ptr);
+        return;
+    }
+
+    auto telnetSession = getTelnetSession(session);
+    if (telnetSession->telnetDecode(packet_ptr) == 0) {
+        // Nothing but telnet commands
+        nx_packet_release(packet_ptr);
+    } else if (!telnetSession->rxQueue.push(packet_ptr)) {
+        // The telnet server does not read from the socket, while the queue is full
+        log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
+                ->println("Stm32NetXTelnet::Server::receive_data() rx queue overflow");
+        nx_packet_release(packet_ptr);
+    }
+
+    // Leave further input on the socket, until loop() has made room in the queue
+    if (telnetSession->rxQueue.isFull()) {
+        auto &client = nx_telnet_server_client_list[logical_connection];
+        client.nx_telnet_client_request_receive_paused = NX_TRUE;
+        // loop() may have emptied the queue meanwhile, without seeing the pause
+        if (!telnetSession->rxQueue.isFull()) {
+            client.nx_telnet_client_request_receive_paused = NX_FALSE;
         }
     }
-    nx_packet_release(packet_ptr);
+    notify(Event::RX);
 }
 
 void Stm32NetXTelnet::Server::connection_end(NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection) {
@@ -89,11 +166,75 @@ void Stm32NetXTelnet::Server::connection_end(NX_TELNET_SERVER_STRUCT *telnet_ser
 
     LIBSMART_UNUSED(telnet_server_ptr);
 
-    auto session = getSessionManager()->getNewSession(logical_connection);
+    SessionLock lock(&sessionMutex);
+    // A session closed by disconnect() has been removed already
+    auto session = getSessionManager()->getSessionById(logical_connection);
     if (session != nullptr) {
         session->end();
         getSessionManager()->removeSession(session);
     }
+    notify(Event::SESSION);
+}
+
+bool Stm32NetXTelnet::Server::evictIdle(UINT except) {
+    log(Stm32ItmLogger::LoggerInterface::Severity::INFORMATIONAL)
+            ->println("Stm32NetXTelnet::Server::evictIdle()");
+
+    const auto now = tx_time_get();
+    UINT oldest = nx_telnet_server_max_clients;
+    ULONG oldestIdle = 0;
+    for (UINT i = 0; i < nx_telnet_server_max_clients; i++) {
+        const auto &client = nx_telnet_server_client_list[i];
+        if (i == except || client.nx_telnet_client_request_state != NX_TELNET_CLIENT_CONNECTED ||
+            client.nx_telnet_client_request_close_requested) {
+            continue;
+        }
+        // The deadline is restarted on every activity
+        const ULONG idle = now - (client.nx_telnet_client_request_deadline -
+                                  client.nx_telnet_client_request_activity_timeout);
+        if (oldest == nx_telnet_server_max_clients || idle > oldestIdle) {
+            oldest = i;
+            oldestIdle = idle;
+        }
+    }
+    // disconnect() ends the session under the session lock, which terminates its command, before the
+    // caller hands the free session to the new connection
+    if (oldest == nx_telnet_server_max_clients || disconnect(oldest) != NX_SUCCESS) {
+        return false;
+    }
+    evictions++;
+    return true;
+}
+
+void Stm32NetXTelnet::Server::reject(UINT logical_connection) {
+    log(Stm32ItmLogger::LoggerInterface::Severity::NOTICE)
+            ->printf("Stm32NetXTelnet::Server::reject(%u)\r\n", logical_connection);
+
+    rejects++;
+    busyPacketCreate();
+    if (busyPacket != nullptr) {
+        if (nx_telnet_server_packet_send(this, logical_connection, busyPacket, NX_NO_WAIT) != NX_SUCCESS) {
+            nx_packet_release(busyPacket);
+        }
+        busyPacket = nullptr;
+    }
+
+    const auto ret = nx_telnet_server_abort(this, logical_connection);
+    if (ret != NX_SUCCESS) {
+        log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
+                ->printf("nx_telnet_server_abort() = 0x%02x\r\n", ret);
+    }
+
+    // Reserve the packet for the next rejection
+    busyPacketCreate();
+}
+
+void Stm32NetXTelnet::Server::busyPacketCreate() {
+    static constexpr char message[] = LIBSMART_STM32NETXTELNET_BUSY_MESSAGE;
+
+    if (busyPacket == nullptr) {
+        packetCreate(busyPacket, message, sizeof(message) - 1, NX_NO_WAIT);
+    }
 }
 
 UINT Stm32NetXTelnet::Server::del() {
@@ -101,7 +242,10 @@ UINT Stm32NetXTelnet::Server::del() {
             ->println("Stm32NetXTelnet::Server::del()");
 
 
-    getSessionManager()->end();
+    {
+        SessionLock lock(&sessionMutex);
+        getSessionManager()->end();
+    }
 
     // https://github.com/eclipse-threadx/rtos-docs/blob/main/rtos-docs/netx-duo/netx-duo-telnet/chapter3.md#nx_telnet_server_delete
     const auto ret = nx_telnet_server_delete(this);
@@ -109,6 +253,8 @@ UINT Stm32NetXTelnet::Server::del() {
         log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
                 ->printf("nx_telnet_server_delete() = 0x%02x\r\n", ret);
     }
+    tx_mutex_delete(&sessionMutex);
+    tx_event_flags_delete(&serverEvents);
     return ret;
 }
 
@@ -117,7 +263,16 @@ UINT Stm32NetXTelnet::Server::disconnect(UINT logical_connection) {
             ->println("Stm32NetXTelnet::Server::disconnect()");
 
 
-    getSessionManager()->removeSession(getSessionManager()->getSessionById(logical_connection));
+    {
+        // The socket closes later, connection_end() finds no session then. End it now, so no packet,
+        // input or command of this connection is left to the next one using the session.
+        SessionLock lock(&sessionMutex);
+        auto session = getSessionManager()->getSessionById(logical_connection);
+        if (session != nullptr) {
+            session->end();
+            getSessionManager()->removeSession(session);
+        }
+    }
 
     // https://github.com/eclipse-threadx/rtos-docs/blob/main/rtos-docs/netx-duo/netx-duo-telnet/chapter3.md#nx_telnet_server_disconnect
     const auto ret = nx_telnet_server_disconnect(this, logical_connection);
@@ -128,6 +283,42 @@ UINT Stm32NetXTelnet::Server::disconnect(UINT logical_connection) {
     return ret;
 }
 
+UINT Stm32NetXTelnet::Server::setClosePolicy(ClosePolicy policy, ULONG lingerTicks) {
+    log(Stm32ItmLogger::LoggerInterface::Severity::INFORMATIONAL)
+            ->println("Stm32NetXTelnet::Server::setClosePolicy()");
+
+    const auto ret = nx_telnet_server_close_policy_set(this, static_cast<UINT>(policy), lingerTicks);
+    if (ret != NX_SUCCESS) {
+        log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
+                ->printf("nx_telnet_server_close_policy_set() = 0x%02x\r\n", ret);
+    }
+    return ret;
+}
+
+UINT Stm32NetXTelnet::Server::setRateLimit(UINT burst, ULONG refillTicks, UINT perSecond) {
+    log(Stm32ItmLogger::LoggerInterface::Severity::INFORMATIONAL)
+            ->println("Stm32NetXTelnet::Server::setRateLimit()");
+
+    const auto ret = nx_telnet_server_rate_limit_set(this, burst, refillTicks, perSecond);
+    if (ret != NX_SUCCESS) {
+        log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
+                ->printf("nx_telnet_server_rate_limit_set() = 0x%02x\r\n", ret);
+    }
+    return ret;
+}
+
+UINT Stm32NetXTelnet::Server::setActivityTimeout(UINT logical_connection, ULONG ticks) {
+    log(Stm32ItmLogger::LoggerInterface::Severity::INFORMATIONAL)
+            ->println("Stm32NetXTelnet::Server::setActivityTimeout()");
+
+    const auto ret = nx_telnet_server_activity_timeout_set(this, logical_connection, ticks);
+    if (ret != NX_SUCCESS) {
+        log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
+                ->printf("nx_telnet_server_activity_timeout_set() = 0x%02x\r\n", ret);
+    }
+    return ret;
+}
+
 UINT Stm32NetXTelnet::Server::getOpenConnectionCount(UINT &connection_count) {
     log(Stm32ItmLogger::LoggerInterface::Severity::INFORMATIONAL)
             ->println("Stm32NetXTelnet::Server::getOpenConnectionCount()");
@@ -155,26 +346,112 @@ UINT Stm32NetXTelnet::Server::packetSend(UINT logical_connection, NX_PACKET *pac
 }
 
 UINT Stm32NetXTelnet::Server::bufferSend(UINT logical_connection, void *buffer, size_t szBuffer, ULONG wait_option) {
-    NX_PACKET *packet{};
-    // NX_PACKET_POOL *packetPool = this->nx_telnet_server_packet_pool_ptr;
-    NX_PACKET_POOL *packetPool = Stm32NetX::NX->getPacketPool();
+    const auto segmentSize = getSegmentSize(logical_connection, getTxPacketPool());
+    auto data = static_cast<const uint8_t *>(buffer);
+    UINT ret = NX_SUCCESS;
+
+    // Send full-sized segments back to back, the last one takes the rest
+    while (szBuffer > 0) {
+        const auto szSegment = szBuffer < segmentSize ? szBuffer : segmentSize;
+        NX_PACKET *packet{};
+
+        ret = packetCreate(packet, data, szSegment, wait_option);
+        if (ret != NX_SUCCESS) {
+            break;
+        }
+        ret = packetSend(logical_connection, packet, wait_option);
+        if (ret != NX_SUCCESS) {
+            nx_packet_release(packet);
+            break;
+        }
+        data += szSegment;
+        szBuffer -= szSegment;
+    }
+    return ret;
+}
 
-    // check, if there are bytes to write
+UINT Stm32NetXTelnet::Server::packetAllocate(NX_PACKET *&packet, size_t size, ULONG wait_option,
+                                             NX_PACKET_POOL *&packetPool) {
+    packetPool = getTxPacketPool(size);
 
     auto ret = nx_packet_allocate(packetPool, &packet, NX_TCP_PACKET, wait_option);
-    if (ret != NX_SUCCESS) {
+    if (ret == NX_NO_PACKET && packetPool != getTxPacketPool()) {
+        // The small pool is exhausted, a large packet does the job as well
+        packetPool = getTxPacketPool();
+        ret = nx_packet_allocate(packetPool, &packet, NX_TCP_PACKET, wait_option);
+    }
+    if (ret != NX_SUCCESS && wait_option != NX_NO_WAIT) {
         log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
                 ->printf("nx_packet_allocate() = 0x%02x\r\n", ret);
+    }
+    return ret;
+}
+
+#ifdef LIBSMART_STM32NETXTELNET_TX_RING
+UINT Stm32NetXTelnet::Server::packetCreateEscaped(NX_PACKET *&packet, const uint8_t *buffer, size_t szBuffer,
+                                                  const uint8_t *buffer2, size_t szBuffer2, size_t szPayload,
+                                                  size_t &copied) {
+    copied = 0;
+    NX_PACKET_POOL *packetPool{};
+    auto ret = packetAllocate(packet, szBuffer + szBuffer2, NX_NO_WAIT, packetPool);
+    if (ret != NX_SUCCESS) {
+        return ret;
+    }
+
+    // Escape straight into the payload, which holds at least one full segment
+    size_t space = packet->nx_packet_data_end - packet->nx_packet_append_ptr;
+    if (space > szPayload) space = szPayload;
+    size_t escaped{};
+    copied = TelnetCodec::encode(buffer, szBuffer, packet->nx_packet_append_ptr, space, escaped);
+    packet->nx_packet_append_ptr += escaped;
+    packet->nx_packet_length += escaped;
+    if (copied == szBuffer && szBuffer2 > 0) {
+        copied += TelnetCodec::encode(buffer2, szBuffer2, packet->nx_packet_append_ptr, space - escaped, escaped);
+        packet->nx_packet_append_ptr += escaped;
+        packet->nx_packet_length += escaped;
+    }
+    return NX_SUCCESS;
+}
+#endif
+
+UINT Stm32NetXTelnet::Server::packetCreate(NX_PACKET *&packet, const void *buffer, size_t szBuffer,
+                                           ULONG wait_option, const void *buffer2, size_t szBuffer2) {
+    NX_PACKET_POOL *packetPool{};
+    auto ret = packetAllocate(packet, szBuffer + szBuffer2, wait_option, packetPool);
+    if (ret != NX_SUCCESS) {
         return ret;
     }
-    ret = nx_packet_data_append(packet, buffer, szBuffer, packetPool, wait_option);
+    ret = nx_packet_data_append(packet, const_cast<void *>(buffer), szBuffer, packetPool, wait_option);
+    if (ret == NX_SUCCESS && szBuffer2 > 0) {
+        ret = nx_packet_data_append(packet, const_cast<void *>(buffer2), szBuffer2, packetPool, wait_option);
+    }
     if (ret != NX_SUCCESS) {
         log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
                 ->printf("nx_packet_data_append() = 0x%02x\r\n", ret);
         nx_packet_release(packet);
+        packet = nullptr;
+    }
+    return ret;
+}
+
+void Stm32NetXTelnet::Server::setTxPacketPools(NX_PACKET_POOL *bulkPool, NX_PACKET_POOL *smallPool) {
+    txPacketPool = bulkPool;
+    txPacketPoolSmall = smallPool;
+}
+
+UINT Stm32NetXTelnet::Server::addPort(UINT port, UINT maxClients, const PortPolicy &policy) {
+    log(Stm32ItmLogger::LoggerInterface::Severity::INFORMATIONAL)
+            ->println("Stm32NetXTelnet::Server::addPort()");
+
+    UINT listener = 0;
+    const auto ret = nx_telnet_server_port_add(this, port, maxClients, &listener);
+    if (ret != NX_SUCCESS) {
+        log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
+                ->printf("nx_telnet_server_port_add() = 0x%02x\r\n", ret);
         return ret;
     }
-    return packetSend(logical_connection, packet, wait_option);
+    policies[listener] = policy;
+    return ret;
 }
 
 #ifdef NX_TELNET_SERVER_USER_CREATE_PACKET_POOL
@@ -183,7 +460,7 @@ UINT Stm32NetXTelnet::Server::packetPoolSet(NX_PACKET_POOL *packet_pool_ptr) {
         ->println("Stm32NetXTelnet::Server::packetPoolSet()");
 
     // https://github.com/eclipse-threadx/rtos-docs/blob/main/rtos-docs/netx-duo/netx-duo-telnet/chapter3.md#nx_telnet_server_packet_pool_set
-    const auto ret = nx_telnet_server_packet_pool_set(this packet_pool_ptr);
+    const auto ret = nx_telnet_server_packet_pool_set(this, packet_pool_ptr);
     if (ret != NX_SUCCESS) {
         log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
                 ->printf("nx_telnet_server_packet_pool_set() = 0x%02x\r\n", ret);
@@ -202,7 +479,11 @@ UINT Stm32NetXTelnet::Server::start() {
         log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
                 ->printf("nx_telnet_server_start() = 0x%02x\r\n", ret);
     }
-    getSessionManager()->setup();
+    {
+        SessionLock lock(&sessionMutex);
+        getSessionManager()->setup();
+    }
+    busyPacketCreate();
     return ret;
 }
 
@@ -210,7 +491,10 @@ UINT Stm32NetXTelnet::Server::stop() {
     log(Stm32ItmLogger::LoggerInterface::Severity::INFORMATIONAL)
             ->println("Stm32NetXTelnet::Server::stop()");
 
-    getSessionManager()->end();
+    {
+        SessionLock lock(&sessionMutex);
+        getSessionManager()->end();
+    }
 
     // https://github.com/eclipse-threadx/rtos-docs/blob/main/rtos-docs/netx-duo/netx-duo-telnet/chapter3.md#nx_telnet_server_stop
     const auto ret = nx_telnet_server_stop(this);
@@ -218,31 +502,340 @@ UINT Stm32NetXTelnet::Server::stop() {
         log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
                 ->printf("nx_telnet_server_stop() = 0x%02x\r\n", ret);
     }
+    if (busyPacket != nullptr) {
+        nx_packet_release(busyPacket);
+        busyPacket = nullptr;
+    }
     return ret;
 }
 
 void Stm32NetXTelnet::Server::loop() {
+    // The telnet server thread must not add or remove a session in the middle of a pass
+    SessionLock lock(&sessionMutex);
+
+    auto session = getSessionManager()->getFirstSession();
+    while (session != nullptr) {
+        auto telnetSession = getTelnetSession(session);
+#ifndef LIBSMART_STM32NETXTELNET_ZERO_COPY_RX
+        // Hand received input to the sessions, as far as it fits
+        rxDeliver(telnetSession);
+#endif
+        // Replies to the telnet commands received by the telnet server thread
+        telnetSession->flushNegotiation();
+        session = getSessionManager()->getNextSession(session);
+    }
+
     // Call the loop() function of the connections
 
     getSessionManager()->loop();
 
-    NX_PACKET *packet{};
-    // NX_PACKET_POOL *packetPool = this->nx_telnet_server_packet_pool_ptr;
-    NX_PACKET_POOL *packetPool = Stm32NetX::NX->getPacketPool();
+    session = getSessionManager()->getFirstSession();
+    while (session != nullptr) {
+        auto telnetSession = getTelnetSession(session);
+#ifndef LIBSMART_STM32NETXTELNET_ZERO_COPY_RX
+        // Come back at once, if the session made room for more of its queued input
+        if (telnetSession->rxQueue.available() > 0 && session->getRxBuffer()->availableForWrite() > 0) {
+            notify(Event::RX);
+        }
+#endif
+        rxResume(telnetSession);
+        session = getSessionManager()->getNextSession(session);
+    }
 
     // check, if there are bytes to write
+    session = getSessionManager()->getFirstSession();
+    while (session != nullptr) {
+        // Output written from now on needs a new notification
+        auto telnetSession = getTelnetSession(session);
+        telnetSession->txNotified = false;
+
+        // A packet that could not be sent before has precedence over new output.
+        // A stalled peer only blocks its own session, never the others.
+        if (telnetSession->txPendingPacket != nullptr && !trySend(telnetSession)) {
+            session = getSessionManager()->getNextSession(session);
+            continue;
+        }
+
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_TX
+        // The session wrote directly into the packet, hand it over to NetX as it is
+        auto txPacket = telnetSession->txPacket.getPacket();
+        if (txPacket != nullptr
+            && isTxDue(telnetSession, txPacket->nx_packet_length, telnetSession->txPacket.availableForWrite())) {
+            telnetSession->txPacket.detach();
+            telnetSession->txPendingPacket = txPacket;
+            trySend(telnetSession);
+        }
+#endif
+#ifdef LIBSMART_STM32NETXTELNET_TX_RING
+        // Cut the committed output of the tx ring into full-sized segments, a segment may span its wrap around
+        auto &txRing = telnetSession->txRing;
+        auto szRing = txRing.available();
+        while (telnetSession->txPendingPacket == nullptr && szRing > 0
+               && isTxDue(telnetSession, szRing, txRing.availableForWrite())) {
+            const auto segmentSize = getSegmentSize(session->getId(), getTxPacketPool());
+            const auto szSegment = szRing < segmentSize ? szRing : segmentSize;
+            const uint8_t *first{};
+            const uint8_t *second{};
+            size_t szFirst{};
+            size_t szSecond{};
+            txRing.peek(first, szFirst, second, szSecond);
+            if (szFirst > szSegment) szFirst = szSegment;
+            szSecond = szSegment - szFirst;
+            // The ring holds the output unescaped, so escaping IAC never has to reserve two bytes at once
+            NX_PACKET *packet{};
+            size_t copied = szSegment;
+            auto ret = telnetSession->raw
+                           ? packetCreate(packet, first, szFirst, NX_NO_WAIT, second, szSecond)
+                           : packetCreateEscaped(packet, first, szFirst, second, szSecond, segmentSize, copied);
+            if (ret != NX_SUCCESS) {
+                break;
+            }
+            txRing.remove(copied);
+            telnetSession->txPendingPacket = packet;
+            trySend(telnetSession);
+            szRing = txRing.available();
+        }
+        // Negotiation waiting for the ring to drain
+        if (telnetSession->txPendingPacket == nullptr && szRing == 0) {
+            telnetSession->flushNegotiation();
+            if (telnetSession->txPendingPacket != nullptr) {
+                trySend(telnetSession);
+            }
+        }
+#endif
+        // Cut the buffered output into full-sized segments, as long as the socket takes them.
+        // The buffer is shifted only once for all segments cut in this pass.
+        auto txBuffer = session->getTxBuffer();
+        const auto szBuffer = txBuffer->available();
+        const auto data = txBuffer->getReadPointer();
+        size_t consumed = 0;
+        while (telnetSession->txPendingPacket == nullptr && consumed < szBuffer
+               && isTxDue(telnetSession, szBuffer - consumed, txBuffer->getRemainingSpace())) {
+            const auto segmentSize = getSegmentSize(session->getId(), getTxPacketPool());
+            const auto szSegment = szBuffer - consumed < segmentSize ? szBuffer - consumed : segmentSize;
+            NX_PACKET *packet{};
+            auto ret = packetCreate(packet, data + consumed, szSegment, NX_NO_WAIT);
+            if (ret != NX_SUCCESS) {
+                break;
+            }
+            consumed += szSegment;
+            telnetSession->txPendingPacket = packet;
+            trySend(telnetSession);
+        }
+        if (consumed > 0) {
+            txBuffer->remove(consumed);
+        }
+
+        // Everything is sent, the next output starts a new coalescing period
+        auto szUnsent = session->getTxBuffer()->available();
+#ifdef LIBSMART_STM32NETXTELNET_ZERO_COPY_TX
+        szUnsent += telnetSession->txPacket.available();
+#endif
+#ifdef LIBSMART_STM32NETXTELNET_TX_RING
+        szUnsent += telnetSession->txRing.available();
+#endif
+        if (telnetSession->txPendingPacket == nullptr && szUnsent == 0) {
+            telnetSession->txPending = false;
+            telnetSession->txFlush = false;
+            telnetSession->txEcho = false;
+        }
+        session = getSessionManager()->getNextSession(session);
+    }
+}
+
+UINT Stm32NetXTelnet::Server::await(ULONG wait_option) {
+    ULONG events{};
+
+    // Wake up for the next timer, even if nothing else happens
+    const auto timeout = getNextTimeout();
+    if (timeout < wait_option) {
+        wait_option = timeout;
+    }
+
+    const auto ret = tx_event_flags_get(&serverEvents, static_cast<ULONG>(Event::ALL), TX_OR_CLEAR,
+                                        &events, wait_option);
+    loop();
+    return ret;
+}
+
+void Stm32NetXTelnet::Server::notify(Event event) {
+    tx_event_flags_set(&serverEvents, static_cast<ULONG>(event), TX_OR);
+}
+
+ULONG Stm32NetXTelnet::Server::getNextTimeout() {
+    ULONG timeout = TX_WAIT_FOREVER;
+    const ULONG now = tx_time_get();
+
+    SessionLock lock(&sessionMutex);
+    // Held back output has to be sent, when its coalescing delay expires
     auto session = getSessionManager()->getFirstSession();
     while (session != nullptr) {
-        if (session->getTxBuffer()->available() > 0) {
-            auto szBuffer = session->getTxBuffer()->available();
-            auto ret = bufferSend(session->getId(),
-                (void *) session->getTxBuffer()->getReadPointer(), szBuffer, 100);
-            if (ret == NX_SUCCESS) {
-                session->getTxBuffer()->remove(szBuffer);
+        auto telnetSession = getTelnetSession(session);
+        if (telnetSession->txPendingPacket != nullptr) {
+#ifdef NX_ENABLE_TCP_QUEUE_DEPTH_UPDATE_NOTIFY
+            // A full transmit queue wakes up the server by itself, when it drains
+            const auto socket = getSocket(session->getId());
+            if (socket->nx_tcp_socket_transmit_sent_count < socket->nx_tcp_socket_transmit_queue_maximum) {
+                timeout = 1;
+            }
+#else
+            // Retry on the next tick
+            timeout = 1;
+#endif
+        } else if (telnetSession->negotiationLength > 0) {
+            // Negotiation, that did not fit into the output, is retried on the next tick
+            timeout = 1;
+        } else if (telnetSession->txPending) {
+            const ULONG elapsed = now - telnetSession->txPendingSince;
+            // Output that is due, but could not be sent for lack of packets, is retried on the next tick
+            const ULONG remaining = elapsed < telnetSession->coalescing.maxDelay
+                                        ? telnetSession->coalescing.maxDelay - elapsed
+                                        : 1;
+            if (remaining < timeout) {
+                timeout = remaining;
             }
         }
         session = getSessionManager()->getNextSession(session);
     }
+    return timeout;
+}
+
+NX_PACKET_POOL *Stm32NetXTelnet::Server::getTxPacketPool() const {
+    return txPacketPool != nullptr ? txPacketPool : Stm32NetX::NX->getPacketPool();
+}
+
+NX_PACKET_POOL *Stm32NetXTelnet::Server::getTxPacketPool(size_t szPayload) const {
+    if (txPacketPoolSmall != nullptr && szPayload <= getPayloadSize(txPacketPoolSmall)) {
+        return txPacketPoolSmall;
+    }
+    return getTxPacketPool();
+}
+
+size_t Stm32NetXTelnet::Server::getPayloadSize(const NX_PACKET_POOL *packetPool) {
+    // Room for the payload behind the headers NetX prepends to a TCP packet
+    return packetPool->nx_packet_pool_payload_size > NX_TCP_PACKET
+               ? packetPool->nx_packet_pool_payload_size - NX_TCP_PACKET
+               : 0;
+}
+
+size_t Stm32NetXTelnet::Server::getSegmentSize(UINT logical_connection, const NX_PACKET_POOL *packetPool) {
+    size_t segmentSize = getPayloadSize(packetPool);
+    if (segmentSize == 0) {
+        segmentSize = 1;
+    }
+
+    // The MSS is only known once the connection is established
+    const auto mss = getSocket(logical_connection)->nx_tcp_socket_connect_mss;
+    if (mss > 0 && mss < segmentSize) {
+        segmentSize = mss;
+    }
+    return segmentSize;
+}
+
+bool Stm32NetXTelnet::Server::isTxDue(LogicalConnectionMicrorl *session, size_t pending, size_t space) {
+    const auto &policy = session->coalescing;
+    const ULONG now = tx_time_get();
+
+    // The coalescing delay starts with the first byte the server sees
+    if (!session->txPending) {
+        session->txPending = true;
+        session->txPendingSince = now;
+    }
+
+    // Flushed output and the echo of the line editor are never held back
+    if (session->txFlush || session->txEcho || policy.maxDelay == 0) {
+        return true;
+    }
+
+    // Enough data for a large or a full-sized segment or the writer is blocked
+    if (pending >= policy.highWatermark || space == 0
+        || pending >= getSegmentSize(session->getId(), getTxPacketPool())) {
+        return true;
+    }
+
+    // Nagle: a medium-sized segment may go out, when nothing is waiting for an ACK
+    if (pending >= policy.lowWatermark && getSocket(session->getId())->nx_tcp_socket_transmit_sent_count == 0) {
+        return true;
+    }
+
+    return now - session->txPendingSince >= policy.maxDelay;
+}
+
+void Stm32NetXTelnet::Server::rxDeliver(LogicalConnectionMicrorl *session) {
+    auto rxBuffer = session->getRxBuffer();
+    const uint8_t *span{};
+    size_t size;
+    while ((size = session->rxQueue.getReadSpan(span)) > 0) {
+        // Deliver as much as fits, the rest stays queued
+        const auto space = rxBuffer->availableForWrite();
+        if (space == 0) {
+            break;
+        }
+        if (size > space) size = space;
+        memcpy(rxBuffer->getWritePointer(), span, size);
+        rxBuffer->setWrittenBytes(size);
+        session->rxQueue.consume(size);
+    }
+}
+
+void Stm32NetXTelnet::Server::rxResume(LogicalConnectionMicrorl *session) {
+    // There is room in the queue again, let the telnet server pick up the data left on the socket
+    auto &client = nx_telnet_server_client_list[session->getId()];
+    if (client.nx_telnet_client_request_receive_paused && !session->rxQueue.isFull()) {
+        nx_telnet_server_receive_resume(this, session->getId());
+    }
+}
+
+bool Stm32NetXTelnet::Server::trySend(LogicalConnectionMicrorl *session) {
+    auto socket = getSocket(session->getId());
+
+    // Do not even try, if NetX would reject the packet anyway
+    if (socket->nx_tcp_socket_transmit_sent_count >= socket->nx_tcp_socket_transmit_queue_maximum) {
+        return false;
+    }
+
+    const auto ret = nx_tcp_socket_send(socket, session->txPendingPacket, NX_NO_WAIT);
+    if (ret != NX_SUCCESS) {
+        // A closed window, a full queue or an empty packet pool resolve by themselves
+        if (ret != NX_WINDOW_OVERFLOW && ret != NX_TX_QUEUE_DEPTH && ret != NX_NO_PACKET) {
+            log(Stm32ItmLogger::LoggerInterface::Severity::ERROR)
+                    ->printf("nx_tcp_socket_send() = 0x%02x\r\n", ret);
+        }
+        return false;
+    }
+    session->txPendingPacket = nullptr;
+    return true;
+}
+
+Stm32NetXTelnet::Broadcast *Stm32NetXTelnet::Server::broadcast(Broadcast::Filter filter) {
+    broadcastStream.setFilter(filter);
+    return &broadcastStream;
+}
+
+void Stm32NetXTelnet::Server::broadcastWrite(const uint8_t *buffer, size_t szBuffer, Broadcast::Filter filter) {
+    SessionLock lock(&sessionMutex);
+    auto session = getSessionManager()->getFirstSession();
+    while (session != nullptr) {
+        auto telnetSession = getTelnetSession(session);
+        if (telnetSession->isSubscribed() && (filter == nullptr || filter(telnetSession))) {
+            // Copied straight into the output buffer, tx ring or transmit packet of the session
+            telnetSession->write(buffer, szBuffer);
+        }
+        session = getSessionManager()->getNextSession(session);
+    }
+}
+
+#ifdef NX_ENABLE_TCP_QUEUE_DEPTH_UPDATE_NOTIFY
+void Stm32NetXTelnet::Server::queueDepthNotify(NX_TCP_SOCKET *socket_ptr) {
+    // The telnet server stores itself in the reserved field of its sockets
+    auto server = static_cast<Server *>(static_cast<NX_TELNET_SERVER *>(socket_ptr->nx_tcp_socket_reserved_ptr));
+    server->notify(Event::TX);
+}
+#endif
+
+Stm32NetXTelnet::LogicalConnectionMicrorl *Stm32NetXTelnet::Server::getTelnetSession(
+    Stm32Common::StreamSession::StreamSessionInterface *session) {
+    return static_cast<LogicalConnectionMicrorl *>(session);
 }
 
 void Stm32NetXTelnet::Server::end() {
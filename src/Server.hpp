@@ -9,11 +9,16 @@
 #include "Loggable.hpp"
 #include "Nameable.hpp"
 #include "nx_api.h"
+#include "Broadcast.hpp"
+#include "CoalescingPolicy.hpp"
 #include "netxduo/addons/telnet/nxd_telnet_server.h"
+#include "PortPolicy.hpp"
 #include "StreamRxTx.hpp"
 #include "StreamSession/StreamSessionAware.hpp"
 
 namespace Stm32NetXTelnet {
+    class LogicalConnectionMicrorl;
+
     class Server
             : protected NX_TELNET_SERVER,
               public Stm32Common::Process::ProcessInterface,
@@ -21,13 +26,64 @@ namespace Stm32NetXTelnet {
               public Stm32ItmLogger::Loggable,
               public Stm32Common::Nameable {
     public:
+        friend Broadcast;
+        friend LogicalConnectionMicrorl;
+
         using new_connection_cb = void(NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection);
         using receive_data_cb = void(NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection,
                                      NX_PACKET *packet_ptr);
         using connection_end_cb = void(NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection);
 
+        /**
+         * @brief Events that wake up a server waiting in await().
+         */
+        enum class Event : ULONG {
+            NONE = (ULONG) 0,
+            RX = (ULONG) 1 << 0,
+            TX = (ULONG) 1 << 1,
+            SESSION = (ULONG) 1 << 2,
+            ALL = RX | TX | SESSION
+        };
+
+        /**
+         * @brief How the server closes connections.
+         */
+        enum class ClosePolicy : UINT {
+            /**
+             * Deliver the output and finish the FIN exchange.
+             * Requires NX_DISABLE_RESET_DISCONNECT, otherwise NetX sends a RST instead of the FIN.
+             */
+            GRACEFUL = NX_TELNET_CLOSE_GRACEFUL,
+            /** Take the connection back at once, dropping the output not acknowledged yet. */
+            ABORTIVE = NX_TELNET_CLOSE_ABORTIVE,
+            /** Close gracefully, but abort after a deadline. */
+            LINGER = NX_TELNET_CLOSE_LINGER
+        };
+
+        /**
+         * @brief What the server does with a new connection, when all sessions are in use.
+         */
+        enum class AdmissionPolicy {
+            /** Send the busy message and close the new connection at once. */
+            REJECT,
+            /** Close the connection idle for the longest time and take its session, reject if none is left. */
+            EVICT_IDLE
+        };
+
+#ifndef NX_TELNET_SERVER_USER_CLIENT_LIST
+        /**
+         * @brief Constructs a server for NX_TELNET_MAX_CLIENTS connections with a receive window of
+         * NX_TELNET_SERVER_WINDOW_SIZE bytes.
+         *
+         * The connections are kept in the client list inside NX_TELNET_SERVER. Use StaticServer to size
+         * every server on its own.
+         *
+         * @param session_mgr The session manager, which must hold NX_TELNET_MAX_CLIENTS sessions of type
+         * LogicalConnectionMicrorl. StaticServer checks its session manager at compile time.
+         */
         explicit Server(Stm32Common::StreamSession::ManagerInterface *session_mgr)
-            : NX_TELNET_SERVER(), StreamSessionAware(session_mgr) { ; }
+            : Server(session_mgr, nullptr, NX_TELNET_MAX_CLIENTS, NX_TELNET_SERVER_WINDOW_SIZE) { ; }
+#endif
 
 
         /**
@@ -83,8 +139,10 @@ namespace Stm32NetXTelnet {
         /**
          * @brief Handles incoming data for a specific Telnet server connection.
          *
-         * This method processes the received data packet for a given Telnet server
-         * connection and stores the extracted data into the connection's receive buffer.
+         * This method queues the received data packet for a given Telnet server connection. loop() copies
+         * the data into the connection's receive buffer, as soon as there is space for it, or the connection
+         * reads it in place with LIBSMART_STM32NETXTELNET_ZERO_COPY_RX. While the queue is full, the Telnet
+         * server leaves further data on the socket, which closes the TCP receive window.
          *
          * @param telnet_server_ptr A pointer to the Telnet server structure.
          * @param logical_connection The identifier for the logical connection that has received data.
@@ -120,7 +178,8 @@ namespace Stm32NetXTelnet {
          * @brief Disconnects a logical connection from the Telnet server.
          *
          * This method removes a session associated with the provided logical connection ID and calls the
-         * underlying NetX Duo function to perform the disconnection process.
+         * underlying NetX Duo function to perform the disconnection process. It returns at once, the server
+         * thread sends the pending output and closes the connection in the background.
          *
          * @param logical_connection The ID of the logical connection to be disconnected.
          *
@@ -128,6 +187,98 @@ namespace Stm32NetXTelnet {
          */
         UINT disconnect(UINT logical_connection);
 
+        /**
+         * @brief Sets how connections are closed by disconnect(), the activity timeout or the client.
+         *
+         * A closing connection holds its slot, until the client has acknowledged the output and the FIN.
+         * Clients, that connect only to run a single command, find a free slot much earlier with a short
+         * linger or an abortive close.
+         *
+         * @param policy The close policy, GRACEFUL by default.
+         * @param lingerTicks The deadline of a LINGER close in ticks, ignored otherwise.
+         *
+         * @return NX_SUCCESS or the error of nx_telnet_server_close_policy_set().
+         */
+        UINT setClosePolicy(ClosePolicy policy, ULONG lingerTicks = 0);
+
+
+        /**
+         * @brief Sets what happens to a new connection, when all sessions are in use.
+         *
+         * A rejected client receives LIBSMART_STM32NETXTELNET_BUSY_MESSAGE and its connection is closed
+         * abortively, so the slot is free again at once and no telnet negotiation is started.
+         *
+         * @param policy The admission policy, REJECT by default.
+         */
+        void setAdmissionPolicy(AdmissionPolicy policy) { admissionPolicy = policy; }
+
+
+        /**
+         * @brief Returns the number of connections rejected, because all sessions were in use.
+         */
+        uint32_t getRejectCount() const { return rejects; }
+
+
+        /**
+         * @brief Returns the number of idle connections closed to admit a new one.
+         */
+        uint32_t getEvictionCount() const { return evictions; }
+
+
+        /**
+         * @brief Limits the rate of new connections, per client address and for all clients together.
+         *
+         * A connection over a limit is dropped without a reply, before it costs a session, the telnet
+         * negotiation or the banner, so a scanner can not keep the server busy. Each of the last
+         * NX_TELNET_SERVER_RATE_SOURCES addresses may open burst connections at once and one more every
+         * refillTicks. The defaults come from NX_TELNET_SERVER_RATE_BURST, NX_TELNET_SERVER_RATE_REFILL
+         * and NX_TELNET_SERVER_RATE_GLOBAL.
+         *
+         * @param burst The connections of an address in a burst, 0 disables the limit per address.
+         * @param refillTicks The ticks, after which an address may open one more connection.
+         * @param perSecond The connections of all clients per second, 0 disables the limit.
+         *
+         * @return NX_SUCCESS or the error of nx_telnet_server_rate_limit_set().
+         */
+        UINT setRateLimit(UINT burst, ULONG refillTicks, UINT perSecond);
+
+
+        /**
+         * @brief Returns the number of connections dropped, because their address exceeded its rate.
+         */
+        uint32_t getRateRejectCount() const { return nx_telnet_server_rate_rejects; }
+
+
+        /**
+         * @brief Returns the number of connections dropped, because all clients together exceeded the rate.
+         */
+        uint32_t getFloodRejectCount() const { return nx_telnet_server_flood_rejects; }
+
+
+        /**
+         * @brief Sets the time a connection may stay idle, before it is closed.
+         *
+         * Applies to connections established afterwards, NX_TELNET_ACTIVITY_TIMEOUT seconds by default.
+         * Every connection has its own deadline, which is checked when it expires, so an idle connection
+         * is closed on the tick and its slot is free for the next client.
+         *
+         * @note Call this method after create().
+         *
+         * @param ticks The idle time in timer ticks or NX_TELNET_NO_ACTIVITY_TIMEOUT to keep idle connections.
+         */
+        void setActivityTimeout(ULONG ticks) { nx_telnet_server_activity_timeout = ticks; }
+
+
+        /**
+         * @brief Sets the idle time of one established connection and restarts it from now.
+         *
+         * @param logical_connection The ID of the logical connection.
+         * @param ticks The idle time in timer ticks or NX_TELNET_NO_ACTIVITY_TIMEOUT to keep the connection.
+         *
+         * @return NX_SUCCESS or NX_TELNET_NOT_CONNECTED, if the connection is not established.
+         */
+        UINT setActivityTimeout(UINT logical_connection, ULONG ticks);
+
 
         /**
          * @brief Retrieves the number of currently open connections on the Telnet server.
@@ -170,7 +321,91 @@ namespace Stm32NetXTelnet {
          */
         UINT bufferSend(UINT logical_connection, void *buffer, size_t szBuffer, ULONG wait_option);
 
+
+        /**
+         * @brief Sets the rules for coalescing small writes of new sessions on the default port.
+         *
+         * The policy is applied to every session, when its connection is established.
+         *
+         * @param policy The coalescing policy.
+         */
+        void setCoalescing(const CoalescingPolicy &policy) { policies[0].coalescing = policy; }
+
+        /**
+         * @brief Enables or disables LINEMODE negotiation (RFC 1184) for new sessions on the default port.
+         *
+         * Clients supporting LINEMODE edit and echo the input locally and send whole lines, which saves
+         * a packet and an echo per keystroke. Other clients keep using microrl. Enabled by default.
+         *
+         * @param enable true to offer LINEMODE.
+         */
+        void setLinemode(bool enable) { policies[0].linemode = enable; }
+
+        /**
+         * @brief Sets dedicated packet pools for the output of the sessions.
+         *
+         * Without dedicated pools, the output is allocated from the packet pool of the IP instance,
+         * which is shared with DHCP, ARP and all other protocols. With a small pool, packets are
+         * chosen by their payload length: short output like echo and control sequences uses the small
+         * pool, bulk output the pool for full-sized segments. If the small pool runs empty, the pool
+         * for full-sized segments is used instead.
+         *
+         * @note Call this method before the server is started.
+         *
+         * @param bulkPool Pool for full-sized segments or nullptr to use the packet pool of the IP instance.
+         * @param smallPool Pool for short output or nullptr to allocate all packets from bulkPool.
+         */
+        void setTxPacketPools(NX_PACKET_POOL *bulkPool, NX_PACKET_POOL *smallPool = nullptr);
+
+        /**
+         * @brief Sets the default TCP port the server listens on, NX_TELNET_SERVER_PORT by default.
+         *
+         * @note Call this method after create() and before the server is started.
+         *
+         * @param port The TCP port.
+         */
+        void setPort(UINT port) { nx_telnet_server_listeners[0].nx_telnet_listener_port = port; }
+
+        /**
+         * @brief Listens on another TCP port with the same server thread and session manager.
+         *
+         * The connections of the port are taken from the default port, which must keep at least one.
+         * The session manager is shared by all ports, so it must hold a session for every connection
+         * of the server.
+         *
+         * @note Call this method after create() and before the server is started.
+         *
+         * @param port The TCP port.
+         * @param maxClients The number of connections of the port.
+         * @param policy The settings of the sessions of the port.
+         *
+         * @return NX_SUCCESS or the error of nx_telnet_server_port_add().
+         */
+        UINT addPort(UINT port, UINT maxClients, const PortPolicy &policy);
+
+        /**
+         * @brief Switches the default port to raw TCP mode.
+         *
+         * Raw sessions skip the telnet option exchange, IAC processing, echo and banner. Input lines
+         * go straight to the command parser and output is sent as it is, which suits automated tools.
+         *
+         * @note Call this method before the server is started.
+         *
+         * @param enable true for raw mode.
+         */
+        void setRawMode(bool enable) { policies[0].raw = enable; }
+
 #ifdef NX_TELNET_SERVER_USER_CREATE_PACKET_POOL
+        /**
+         * @brief Sets the packet pool the telnet server uses to negotiate telnet options.
+         *
+         * Only available, if NX_TELNET_SERVER_USER_CREATE_PACKET_POOL is defined, otherwise the telnet
+         * server creates this pool itself.
+         *
+         * @param packet_pool_ptr A pointer to the packet pool.
+         *
+         * @return An unsigned integer status code indicating the result of the operation.
+         */
         UINT packetPoolSet(NX_PACKET_POOL *packet_pool_ptr);
 #endif
 
@@ -216,6 +451,54 @@ namespace Stm32NetXTelnet {
         void loop() override;
 
 
+        /**
+         * @brief Waits for server events and executes the main loop.
+         *
+         * This method blocks on the server event flags until data is received, a session has written
+         * output, a session starts or ends, the next timer of the server is due or wait_option expires.
+         * Then it runs loop(). It replaces polling loop() on every tick, so output is sent as soon as it
+         * is written and an idle server does not use any CPU time.
+         *
+         * The telnet server thread only accepts, receives and closes connections. The sessions are
+         * processed in the thread calling await(), which is usually a thread of its own. The session list
+         * is shared by both threads under a mutex, so a connection may start or end at any time.
+         *
+         * @param wait_option Maximum number of ticks to wait for an event.
+         *
+         * @return TX_SUCCESS if an event was present, TX_NO_EVENTS if the wait timed out.
+         */
+        UINT await(ULONG wait_option = TX_WAIT_FOREVER);
+
+
+        /**
+         * @brief Wakes up the server waiting in await().
+         *
+         * This method is safe to call from any thread.
+         *
+         * @param event The event that occurred.
+         */
+        void notify(Event event);
+
+
+        /**
+         * @brief Returns a stream, that sends its output to all sessions.
+         *
+         * The output is formatted only once and then copied to every session, that is subscribed
+         * and passes the filter. The stream may be used from any thread, each write is formatted and
+         * fanned out as a whole. The filter applies to the following output until the next call, so
+         * threads broadcasting with different filters have to take turns. Output before create() is dropped.
+         *
+         * @code
+         * telnetServer.broadcast()->printf("counter = %d\r\n", counter);
+         * @endcode
+         *
+         * @param filter Selects the sessions that receive the output, nullptr for all subscribed sessions.
+         *
+         * @return A pointer to the broadcast stream.
+         */
+        Broadcast *broadcast(Broadcast::Filter filter = nullptr);
+
+
         /**
          * @brief Terminates the Telnet server instance.
          *
@@ -241,6 +524,223 @@ namespace Stm32NetXTelnet {
         }
 
     protected:
+        /**
+         * @brief Constructs a server with a client list of its own.
+         *
+         * @param session_mgr The session manager, which must hold maxClients sessions.
+         * @param clientList The client list of the server or nullptr for the list inside NX_TELNET_SERVER.
+         * @param maxClients The number of entries of the client list.
+         * @param windowSize The TCP receive window of each connection in bytes.
+         */
+        Server(Stm32Common::StreamSession::ManagerInterface *session_mgr, NX_TELNET_CLIENT_REQUEST *clientList,
+               UINT maxClients, ULONG windowSize)
+            : NX_TELNET_SERVER(), StreamSessionAware(session_mgr),
+              clientList(clientList), maxClients(maxClients), windowSize(windowSize) { ; }
+
+        /**
+         * @brief Returns the telnet session behind a session of the session manager.
+         *
+         * The session manager of a telnet server manages LogicalConnectionMicrorl sessions. This method
+         * gives the server access to the telnet specific parts of such a session.
+         *
+         * @param session A pointer to a session obtained from the session manager.
+         *
+         * @return A pointer to the telnet session.
+         */
+        static LogicalConnectionMicrorl *getTelnetSession(Stm32Common::StreamSession::StreamSessionInterface *session);
+
+        /**
+         * @brief Returns the number of ticks until the next timer of the server is due.
+         *
+         * @return Number of ticks or TX_WAIT_FOREVER, if no timer is pending.
+         */
+        ULONG getNextTimeout();
+
+        /**
+         * @brief Returns the TCP socket of a logical connection.
+         *
+         * @param logical_connection The logical connection identifier.
+         *
+         * @return A pointer to the TCP socket.
+         */
+        NX_TCP_SOCKET *getSocket(UINT logical_connection) {
+            return &nx_telnet_server_client_list[logical_connection].nx_telnet_client_request_socket;
+        }
+
+        /**
+         * @brief Returns the packet pool for full-sized segments.
+         *
+         * @return The dedicated bulk pool or the packet pool of the IP instance.
+         */
+        NX_PACKET_POOL *getTxPacketPool() const;
+
+        /**
+         * @brief Returns the packet pool of the smallest size class, that holds a given payload.
+         *
+         * @param szPayload The number of payload bytes.
+         *
+         * @return The small pool, if it is set and the payload fits, the pool for full-sized segments otherwise.
+         */
+        NX_PACKET_POOL *getTxPacketPool(size_t szPayload) const;
+
+        /**
+         * @brief Returns the number of TCP payload bytes a single packet of a pool holds.
+         *
+         * @param packetPool The packet pool.
+         *
+         * @return The payload size behind the headers NetX prepends to a TCP packet.
+         */
+        static size_t getPayloadSize(const NX_PACKET_POOL *packetPool);
+
+        /**
+         * @brief Returns the number of payload bytes of a full-sized segment for a logical connection.
+         *
+         * This is the MSS negotiated with the peer, limited to the payload a single packet of the pool
+         * can hold, so segments are sent without packet chaining and without being split again by NetX.
+         *
+         * @param logical_connection The logical connection identifier.
+         * @param packetPool The packet pool segments are allocated from.
+         *
+         * @return The segment size in bytes.
+         */
+        size_t getSegmentSize(UINT logical_connection, const NX_PACKET_POOL *packetPool);
+
+        /**
+         * @brief Decides, if the pending output of a session is sent now or held back to coalesce it.
+         *
+         * @param session The session with pending output.
+         * @param pending Number of bytes waiting to be sent.
+         * @param space Number of bytes the session can still write, before its output buffer is full.
+         *
+         * @return true, if the output is sent now.
+         */
+        bool isTxDue(LogicalConnectionMicrorl *session, size_t pending, size_t space);
+
+        /**
+         * @brief Copies queued input of a session into its rx buffer, as far as it fits.
+         *
+         * @param session The session to deliver the input to.
+         */
+        void rxDeliver(LogicalConnectionMicrorl *session);
+
+        /**
+         * @brief Lets the telnet server receive data for a session again, once its rx queue has room.
+         *
+         * While the rx queue of a session is full, the telnet server leaves further data on the socket,
+         * so the receive window of the connection closes, instead of input being dropped.
+         *
+         * @param session The session to check.
+         */
+        void rxResume(LogicalConnectionMicrorl *session);
+
+        /**
+         * @brief Tries to send the pending packet of a session without blocking.
+         *
+         * The packet is only handed to NetX, if the transmit queue of the socket is not full. If NetX
+         * can not take it, because the queue is full or the window of the peer is closed, the packet
+         * stays in the pending slot of the session and is retried on the next pass.
+         *
+         * @param session The session with a pending packet.
+         *
+         * @return true, if the packet was sent.
+         */
+        bool trySend(LogicalConnectionMicrorl *session);
+
+        /**
+         * @brief Allocates a packet for a payload of the given size.
+         *
+         * The packet is allocated from the pool, that matches the size, or from the bulk pool, if the
+         * matching pool is exhausted.
+         *
+         * @param packet Reference to a pointer, which is set to the new packet.
+         * @param size The size of the payload.
+         * @param wait_option The wait option for packet operations.
+         * @param packetPool Reference to a pointer, which is set to the pool of the packet.
+         *
+         * @return A UINT status code indicating the outcome of the operation.
+         */
+        UINT packetAllocate(NX_PACKET *&packet, size_t size, ULONG wait_option, NX_PACKET_POOL *&packetPool);
+
+#ifdef LIBSMART_STM32NETXTELNET_TX_RING
+        /**
+         * @brief Allocates a packet and copies up to two buffers into it, doubling all IAC bytes.
+         *
+         * @param packet Reference to a pointer, which is set to the new packet.
+         * @param buffer A pointer to the data to copy.
+         * @param szBuffer The size of the data.
+         * @param buffer2 A pointer to the data to append.
+         * @param szBuffer2 The size of the data to append.
+         * @param szPayload The maximum payload of the packet after escaping.
+         * @param copied Reference to the number of bytes taken from both buffers.
+         *
+         * @return A UINT status code indicating the outcome of the operation.
+         */
+        UINT packetCreateEscaped(NX_PACKET *&packet, const uint8_t *buffer, size_t szBuffer,
+                                 const uint8_t *buffer2, size_t szBuffer2, size_t szPayload, size_t &copied);
+#endif
+
+        /**
+         * @brief Allocates a packet and copies a buffer into it.
+         *
+         * The packet is allocated from the pool, that matches the size of the data. An optional second
+         * buffer is appended behind the first one, e.g. the part of a ring buffer behind its wrap around.
+         *
+         * @param packet Reference to a pointer, which is set to the new packet.
+         * @param buffer A pointer to the data to copy.
+         * @param szBuffer The size of the data.
+         * @param wait_option The wait option for packet operations.
+         * @param buffer2 A pointer to the data to append or nullptr.
+         * @param szBuffer2 The size of the data to append.
+         *
+         * @return A UINT status code indicating the outcome of the operation.
+         */
+        UINT packetCreate(NX_PACKET *&packet, const void *buffer, size_t szBuffer, ULONG wait_option,
+                          const void *buffer2 = nullptr, size_t szBuffer2 = 0);
+
+        /**
+         * @brief Copies broadcast data into the output of every matching session.
+         *
+         * A session, whose output is full, loses the part of the data that does not fit.
+         *
+         * @param buffer A pointer to the data.
+         * @param szBuffer The size of the data.
+         * @param filter Selects the sessions that receive the data, nullptr for all subscribed sessions.
+         */
+        void broadcastWrite(const uint8_t *buffer, size_t szBuffer, Broadcast::Filter filter);
+
+        /**
+         * @brief Closes the established connection idle for the longest time, except one.
+         *
+         * @param except The logical connection, that is not considered.
+         *
+         * @return true, if a connection has been closed and its session is free.
+         */
+        bool evictIdle(UINT except);
+
+        /**
+         * @brief Sends the busy message to a new connection and aborts it.
+         *
+         * The message comes from a packet reserved at start(), so a rejection works even when the
+         * packet pool is exhausted by the sessions in use.
+         *
+         * @param logical_connection The ID of the logical connection to reject.
+         */
+        void reject(UINT logical_connection);
+
+        /**
+         * @brief Creates the reserved busy message packet, unless it exists already.
+         */
+        void busyPacketCreate();
+
+#ifdef NX_ENABLE_TCP_QUEUE_DEPTH_UPDATE_NOTIFY
+        /**
+         * @brief Wakes up the server, when the transmit queue of a socket is no longer full.
+         *
+         * @param socket_ptr A pointer to the TCP socket.
+         */
+        static void queueDepthNotify(NX_TCP_SOCKET *socket_ptr);
+#endif
+
         template<class T, class Method, Method m, class... Params>
         /**
          * @brief Invokes a specified member function on the Telnet server instance.
@@ -260,6 +760,40 @@ namespace Stm32NetXTelnet {
             assert_param(telnetServer != nullptr);
             return ((*telnetServer).*m)(telnet_server_ptr, params...);
         }
+
+    private:
+        /**
+         * @brief Holds the session mutex of a server, while the session list is walked or changed.
+         *
+         * The mutex is recursive, so a thread holding it may lock it again.
+         */
+        class SessionLock {
+        public:
+            explicit SessionLock(TX_MUTEX *mutex) : mutex(mutex) { tx_mutex_get(mutex, TX_WAIT_FOREVER); }
+
+            ~SessionLock() { tx_mutex_put(mutex); }
+
+            SessionLock(const SessionLock &) = delete;
+
+            SessionLock &operator=(const SessionLock &) = delete;
+
+        private:
+            TX_MUTEX *mutex;
+        };
+
+        NX_TELNET_CLIENT_REQUEST *clientList;
+        UINT maxClients;
+        ULONG windowSize;
+        TX_EVENT_FLAGS_GROUP serverEvents{};
+        TX_MUTEX sessionMutex{};
+        PortPolicy policies[NX_TELNET_SERVER_MAX_PORTS]{};
+        Broadcast broadcastStream{this};
+        NX_PACKET_POOL *txPacketPool{};
+        NX_PACKET_POOL *txPacketPoolSmall{};
+        AdmissionPolicy admissionPolicy{AdmissionPolicy::REJECT};
+        NX_PACKET *busyPacket{};
+        uint32_t rejects{};
+        uint32_t evictions{};
     };
 }
 
@@ -0,0 +1,107 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBSMART_STM32NETXTELNET_SESSIONMANAGER_HPP
+#define LIBSMART_STM32NETXTELNET_SESSIONMANAGER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <libsmart_config.hpp>
+#include "StreamSession/ManagerInterface.hpp"
+#include "LogicalConnectionMicrorl.hpp"
+
+namespace Stm32NetXTelnet {
+    /**
+     * @brief Session manager with a fixed number of telnet sessions inside the object.
+     *
+     * Hands out LogicalConnectionMicrorl sessions, which is what a Server expects from its session
+     * manager. StaticServer checks Session and MAX_SESSIONS of its manager at compile time.
+     *
+     * @tparam MaxSessions Number of sessions.
+     */
+    template<size_t MaxSessions = LIBSMART_STM32NETXTELNET_SERVER_MAX_CONNECTIONS>
+    class SessionManager : public Stm32Common::StreamSession::ManagerInterface {
+        static_assert(MaxSessions > 0, "A session manager needs at least one session");
+
+    public:
+        using Session = LogicalConnectionMicrorl;
+        using StreamSessionInterface = Stm32Common::StreamSession::StreamSessionInterface;
+
+        static constexpr size_t MAX_SESSIONS = MaxSessions;
+
+        StreamSessionInterface *getNewSession(uint32_t id) override {
+            for (size_t i = 0; i < MaxSessions; i++) {
+                if (!used[i]) {
+                    used[i] = true;
+                    sessions[i].setId(id);
+                    return &sessions[i];
+                }
+            }
+            return nullptr;
+        }
+
+        StreamSessionInterface *getSessionById(uint32_t id) override {
+            for (size_t i = 0; i < MaxSessions; i++) {
+                if (used[i] && sessions[i].getId() == id) {
+                    return &sessions[i];
+                }
+            }
+            return nullptr;
+        }
+
+        StreamSessionInterface *getFirstSession() override {
+            return find(0);
+        }
+
+        StreamSessionInterface *getNextSession(StreamSessionInterface *session) override {
+            // Works for a session removed during the walk as well
+            return session == nullptr ? nullptr : find(indexOf(session) + 1);
+        }
+
+        void removeSession(StreamSessionInterface *session) override {
+            if (session == nullptr) return;
+            const auto i = indexOf(session);
+            if (i < MaxSessions) {
+                used[i] = false;
+            }
+        }
+
+        void setup() override { ; }
+
+        void loop() override {
+            for (auto session = getFirstSession(); session != nullptr; session = getNextSession(session)) {
+                session->loop();
+            }
+        }
+
+        void end() override {
+            for (size_t i = 0; i < MaxSessions; i++) {
+                if (used[i]) {
+                    sessions[i].end();
+                    used[i] = false;
+                }
+            }
+        }
+
+    private:
+        StreamSessionInterface *find(size_t from) {
+            for (size_t i = from; i < MaxSessions; i++) {
+                if (used[i]) {
+                    return &sessions[i];
+                }
+            }
+            return nullptr;
+        }
+
+        size_t indexOf(StreamSessionInterface *session) {
+            return static_cast<size_t>(static_cast<Session *>(session) - sessions);
+        }
+
+        Session sessions[MaxSessions]{};
+        bool used[MaxSessions]{};
+    };
+}
+
+#endif
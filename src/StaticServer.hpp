@@ -0,0 +1,71 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBSMART_STM32NETXTELNET_STATICSERVER_HPP
+#define LIBSMART_STM32NETXTELNET_STATICSERVER_HPP
+
+#include <type_traits>
+#include <libsmart_config.hpp>
+#include "Server.hpp"
+#include "SessionManager.hpp"
+
+#ifndef NX_TELNET_SERVER_USER_CLIENT_LIST
+#error "StaticServer needs NX_TELNET_SERVER_USER_CLIENT_LIST, define it in nx_user.h"
+#endif
+
+namespace Stm32NetXTelnet {
+    /**
+     * @brief Telnet server with a client list of a fixed size inside the object.
+     *
+     * Every server pays only for its own connections, so e.g. a console for 2 administrators and a
+     * bulk server for 16 clients run side by side. The sizes and the session manager are checked at
+     * compile time. Needs NX_TELNET_SERVER_USER_CLIENT_LIST in nx_user.h, which drops the client list
+     * of NX_TELNET_MAX_CLIENTS clients from the NetX Duo server structure.
+     *
+     * @code
+     * static Stm32NetXTelnet::SessionManager<2> adminSessions;
+     * static Stm32NetXTelnet::StaticServer<2> adminServer(&adminSessions);
+     * static Stm32NetXTelnet::SessionManager<16> bulkSessions;
+     * static Stm32NetXTelnet::StaticServer<16, 8192> bulkServer(&bulkSessions);
+     * @endcode
+     *
+     * @tparam MaxClients Number of simultaneous connections.
+     * @tparam WindowSize TCP receive window of each connection in bytes.
+     * @tparam Manager Session manager, that declares its Session type and its number of sessions
+     *                 as MAX_SESSIONS like SessionManager does.
+     */
+    template<UINT MaxClients = LIBSMART_STM32NETXTELNET_SERVER_MAX_CONNECTIONS,
+        ULONG WindowSize = NX_TELNET_SERVER_WINDOW_SIZE,
+        class Manager = SessionManager<MaxClients> >
+    class StaticServer : public Server {
+        static_assert(MaxClients > 0, "A telnet server needs at least one connection");
+        static_assert(MaxClients <= NX_TELNET_SERVER_CLIENTS_LIMIT,
+                      "MaxClients exceeds NX_TELNET_SERVER_CLIENTS_LIMIT of the socket bitmaps");
+        static_assert(WindowSize > 0, "The receive window must not be empty");
+#ifndef NX_ENABLE_TCP_WINDOW_SCALING
+        static_assert(WindowSize <= 0xffff, "A receive window above 65535 bytes needs NX_ENABLE_TCP_WINDOW_SCALING");
+#endif
+        static_assert(std::is_base_of<Stm32Common::StreamSession::ManagerInterface, Manager>::value,
+                      "Manager must implement the ManagerInterface");
+        static_assert(std::is_base_of<LogicalConnectionMicrorl, typename Manager::Session>::value,
+                      "The sessions of a telnet server must be LogicalConnectionMicrorl sessions");
+        static_assert(Manager::MAX_SESSIONS >= MaxClients,
+                      "The session manager must hold a session for every connection");
+
+    public:
+        /**
+         * @brief Constructs the server.
+         *
+         * @param session_mgr The session manager.
+         */
+        explicit StaticServer(Manager *session_mgr)
+            : Server(session_mgr, clients, MaxClients, WindowSize) { ; }
+
+    private:
+        NX_TELNET_CLIENT_REQUEST clients[MaxClients]{};
+    };
+}
+
+#endif
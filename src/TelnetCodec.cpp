@@ -0,0 +1,185 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TelnetCodec.hpp"
+#include <cstring>
+
+size_t Stm32NetXTelnet::TelnetCodec::decode(uint8_t *data, size_t size, Handler &handler) {
+    size_t out = 0;
+    size_t i = 0;
+    while (i < size) {
+        if (state == State::DATA) {
+            // Plain data is only moved, if commands have been removed before it
+            const auto run = scanData(data + i, size - i);
+            if (out != i) {
+                memmove(data + out, data + i, run);
+            }
+            out += run;
+            i += run;
+            if (i >= size) break;
+        }
+
+        const auto ch = data[i++];
+        switch (state) {
+            case State::DATA:
+                if (ch == IAC) {
+                    state = State::IAC;
+                } else {
+                    data[out++] = ch;
+                    if (!binary) {
+                        state = State::CR;
+                    }
+                }
+                break;
+
+            case State::CR:
+                // CR NUL is a bare carriage return
+                state = State::DATA;
+                if (ch != 0) {
+                    i--;
+                }
+                break;
+
+            case State::IAC:
+                if (ch == IAC) {
+                    data[out++] = IAC;
+                    state = State::DATA;
+                } else if (ch >= WILL) {
+                    verb = ch;
+                    state = State::OPTION;
+                } else if (ch == SB) {
+                    state = State::SB;
+                } else {
+                    handler.telnetCommand(ch);
+                    state = State::DATA;
+                }
+                break;
+
+            case State::OPTION:
+                handler.telnetOption(verb, ch);
+                state = State::DATA;
+                break;
+
+            case State::SB:
+                sbOption = ch;
+                sbLength = 0;
+                sbOverflow = false;
+                state = State::SB_DATA;
+                break;
+
+            case State::SB_DATA:
+                if (ch == IAC) {
+                    state = State::SB_IAC;
+                } else if (sbLength < sizeof(sbBuffer)) {
+                    sbBuffer[sbLength++] = ch;
+                } else {
+                    sbOverflow = true;
+                }
+                break;
+
+            case State::SB_IAC:
+                if (ch == IAC) {
+                    if (sbLength < sizeof(sbBuffer)) {
+                        sbBuffer[sbLength++] = ch;
+                    } else {
+                        sbOverflow = true;
+                    }
+                    state = State::SB_DATA;
+                } else if (ch == SE) {
+                    // A truncated subnegotiation would be misread, so it is dropped
+                    if (!sbOverflow) {
+                        handler.telnetSubnegotiation(sbOption, sbBuffer, sbLength);
+                    }
+                    state = State::DATA;
+                } else {
+                    // Any other command ends the subnegotiation
+                    state = State::IAC;
+                    i--;
+                }
+                break;
+        }
+    }
+    return out;
+}
+
+size_t Stm32NetXTelnet::TelnetCodec::encode(uint8_t *data, size_t size, size_t space, size_t &escaped) {
+    // Count the IAC bytes, that fit into space after doubling
+    size_t count = 0;
+    size_t fit = size;
+    for (auto iac = static_cast<uint8_t *>(memchr(data, IAC, size)); iac != nullptr;
+         iac = static_cast<uint8_t *>(memchr(iac + 1, IAC, size - (iac + 1 - data)))) {
+        const size_t index = iac - data;
+        if (index + count + 2 > space) {
+            fit = index;
+            break;
+        }
+        count++;
+    }
+    if (fit + count > space) {
+        fit = space - count;
+    }
+
+    // Spread the data from the end, so every byte is moved exactly once
+    escaped = fit + count;
+    auto dst = escaped;
+    for (auto src = fit; count > 0 && src > 0;) {
+        const auto ch = data[--src];
+        data[--dst] = ch;
+        if (ch == IAC) {
+            data[--dst] = IAC;
+            count--;
+        }
+    }
+    return fit;
+}
+
+size_t Stm32NetXTelnet::TelnetCodec::encode(const uint8_t *src, size_t size, uint8_t *dst, size_t space,
+                                            size_t &escaped) {
+    size_t copied = 0;
+    escaped = 0;
+    while (copied < size) {
+        // Copy everything up to the next IAC in one go
+        const auto iac = static_cast<const uint8_t *>(memchr(src + copied, IAC, size - copied));
+        auto run = (iac != nullptr ? static_cast<size_t>(iac - src) : size) - copied;
+        if (run > space - escaped) run = space - escaped;
+        memcpy(dst + escaped, src + copied, run);
+        escaped += run;
+        copied += run;
+        if (iac == nullptr || src + copied != iac || space - escaped < 2) break;
+        dst[escaped++] = IAC;
+        dst[escaped++] = IAC;
+        copied++;
+    }
+    return copied;
+}
+
+void Stm32NetXTelnet::TelnetCodec::reset() {
+    state = State::DATA;
+    binary = false;
+    verb = 0;
+    sbOption = 0;
+    sbOverflow = false;
+    sbLength = 0;
+}
+
+size_t Stm32NetXTelnet::TelnetCodec::scanData(const uint8_t *data, size_t size) {
+    size_t i = 0;
+
+    // Check 4 bytes at once for IAC (0xff) or CR (0x0d)
+    for (; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t)) {
+        uint32_t word;
+        memcpy(&word, data + i, sizeof(word));
+        const uint32_t cr = word ^ 0x0d0d0d0du;
+        const uint32_t iacs = (~word - 0x01010101u) & word & 0x80808080u;
+        const uint32_t crs = (cr - 0x01010101u) & ~cr & 0x80808080u;
+        if ((iacs | crs) != 0) break;
+    }
+
+    // Locate the special byte inside the word or check the tail
+    for (; i < size; i++) {
+        if (data[i] == IAC || data[i] == '\r') break;
+    }
+    return i;
+}
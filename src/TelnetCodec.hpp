@@ -0,0 +1,141 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBSMART_STM32NETXTELNET_TELNETCODEC_HPP
+#define LIBSMART_STM32NETXTELNET_TELNETCODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <libsmart_config.hpp>
+
+namespace Stm32NetXTelnet {
+    /**
+     * @brief Resumable decoder for the telnet protocol (RFC 854, RFC 855).
+     *
+     * Removes telnet commands from the received data and reports them to a handler. Commands may
+     * appear at any position and may be split across packets, as the decoder keeps its state between
+     * calls. IAC IAC is decoded to a single 0xff data byte, CR NUL to a single CR. Subnegotiations are
+     * collected in a bounded buffer and reported, when they are complete.
+     */
+    class TelnetCodec {
+    public:
+        static constexpr uint8_t SE = 240;
+        static constexpr uint8_t SB = 250;
+        static constexpr uint8_t WILL = 251;
+        static constexpr uint8_t WONT = 252;
+        static constexpr uint8_t DO = 253;
+        static constexpr uint8_t DONT = 254;
+        static constexpr uint8_t IAC = 255;
+
+        /**
+         * @brief Receives the telnet commands found by the decoder.
+         */
+        class Handler {
+        public:
+            virtual ~Handler() = default;
+
+            /**
+             * @brief Called for a command without option, like NOP, AYT or GA.
+             *
+             * @param command The command byte.
+             */
+            virtual void telnetCommand(uint8_t /* command */) { ; }
+
+            /**
+             * @brief Called for an option negotiation.
+             *
+             * @param verb WILL, WONT, DO or DONT.
+             * @param option The option code.
+             */
+            virtual void telnetOption(uint8_t /* verb */, uint8_t /* option */) { ; }
+
+            /**
+             * @brief Called for a complete subnegotiation, that fits into the buffer of the decoder.
+             *
+             * @param option The option code.
+             * @param data A pointer to the parameters, with IAC IAC already decoded.
+             * @param size The number of parameter bytes.
+             */
+            virtual void telnetSubnegotiation(uint8_t /* option */, const uint8_t * /* data */, size_t /* size */) { ; }
+        };
+
+        /**
+         * @brief Decodes a block of received data in place.
+         *
+         * @param data A pointer to the data, which is overwritten with the plain data.
+         * @param size The number of bytes.
+         * @param handler The handler for the telnet commands.
+         *
+         * @return Number of plain data bytes at the beginning of data.
+         */
+        size_t decode(uint8_t *data, size_t size, Handler &handler);
+
+        /**
+         * @brief Switches between NVT and binary input (RFC 856).
+         *
+         * In binary mode a CR is plain data, so a NUL following it is kept.
+         *
+         * @param enable true for binary input.
+         */
+        void setBinary(bool enable) { binary = enable; }
+
+        /**
+         * @brief Returns true, if the input is decoded as binary data.
+         */
+        bool isBinary() const { return binary; }
+
+        /**
+         * @brief Doubles all IAC bytes of a block of output in place.
+         *
+         * @param data A pointer to the output, followed by free space.
+         * @param size The number of output bytes.
+         * @param space The number of bytes available at data, including size.
+         * @param escaped Reference to the number of bytes at data after escaping.
+         *
+         * @return Number of output bytes escaped, less than size if the escaped data does not fit into space.
+         */
+        static size_t encode(uint8_t *data, size_t size, size_t space, size_t &escaped);
+
+        /**
+         * @brief Copies a block of output and doubles all IAC bytes on the way.
+         *
+         * @param src A pointer to the output.
+         * @param size The number of output bytes.
+         * @param dst A pointer to the destination.
+         * @param space The number of bytes available at dst.
+         * @param escaped Reference to the number of bytes written to dst.
+         *
+         * @return Number of output bytes copied, less than size if the escaped data does not fit into space.
+         */
+        static size_t encode(const uint8_t *src, size_t size, uint8_t *dst, size_t space, size_t &escaped);
+
+        /**
+         * @brief Resets the decoder for a new connection.
+         */
+        void reset();
+
+    private:
+        enum class State : uint8_t {
+            DATA, CR, IAC, OPTION, SB, SB_DATA, SB_IAC
+        };
+
+        /**
+         * @brief Returns the number of leading bytes, that are neither IAC nor CR.
+         *
+         * Scans a word at a time.
+         */
+        static size_t scanData(const uint8_t *data, size_t size);
+
+        State state = State::DATA;
+        bool binary = false;
+        uint8_t verb{};
+        uint8_t sbOption{};
+        bool sbOverflow = false;
+        size_t sbLength{};
+        uint8_t sbBuffer[LIBSMART_STM32NETXTELNET_SB_BUFFER_SIZE]{};
+    };
+}
+
+#endif
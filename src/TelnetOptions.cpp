@@ -0,0 +1,138 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TelnetOptions.hpp"
+#include "TelnetCodec.hpp"
+
+using namespace Stm32NetXTelnet;
+
+void TelnetOptions::receive(uint8_t verb, uint8_t option, Handler &handler) {
+    if (verb < TelnetCodec::WILL || verb > TelnetCodec::DONT) return;
+
+    const auto side = verb == TelnetCodec::DO || verb == TelnetCodec::DONT ? Side::LOCAL : Side::REMOTE;
+    const bool enable = verb == TelnetCodec::WILL || verb == TelnetCodec::DO;
+    const auto index = indexOf(option);
+    if (index == OPTION_COUNT) {
+        // Unsupported options stay disabled, a refusal of WONT or DONT would start a loop
+        if (enable) {
+            handler.telnetSend(side == Side::LOCAL ? TelnetCodec::WONT : TelnetCodec::DONT, option);
+        }
+        return;
+    }
+    receive(states[static_cast<size_t>(side)][index], side, option, enable, handler);
+}
+
+void TelnetOptions::receive(uint8_t &state, Side side, uint8_t option, bool enable, Handler &handler) {
+    const auto send = [&](bool on) {
+        handler.telnetSend(side == Side::LOCAL
+                               ? (on ? TelnetCodec::WILL : TelnetCodec::WONT)
+                               : (on ? TelnetCodec::DO : TelnetCodec::DONT), option);
+    };
+    const bool queued = (state & OPPOSITE) != 0;
+    const auto before = state & STATE_MASK;
+    auto after = before;
+
+    if (enable) {
+        switch (before) {
+            case NO:
+                if (handler.telnetAccept(side, option)) {
+                    after = YES;
+                    send(true);
+                } else {
+                    send(false);
+                }
+                break;
+            case WANTNO:
+                // Without a queued request, the client answered a disable with an enable
+                after = queued ? YES : NO;
+                break;
+            case WANTYES:
+                after = queued ? WANTNO : YES;
+                if (queued) send(false);
+                break;
+            default:
+                break;
+        }
+    } else {
+        switch (before) {
+            case YES:
+                after = NO;
+                send(false);
+                break;
+            case WANTNO:
+                after = queued ? WANTYES : NO;
+                if (queued) send(true);
+                break;
+            case WANTYES:
+                after = NO;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (after != before) {
+        state = after;
+        // The option stays enabled, until the client has agreed to disable it
+        const bool wasEnabled = before == YES || before == WANTNO;
+        const bool isEnabled = after == YES || after == WANTNO;
+        if (wasEnabled != isEnabled) {
+            handler.telnetChanged(side, option, isEnabled);
+        }
+    }
+}
+
+void TelnetOptions::request(Side side, uint8_t option, bool enable, Handler &handler) {
+    const auto index = indexOf(option);
+    if (index == OPTION_COUNT) return;
+
+    auto &state = states[static_cast<size_t>(side)][index];
+    const bool queued = (state & OPPOSITE) != 0;
+    switch (state & STATE_MASK) {
+        case NO:
+            if (enable) {
+                state = WANTYES;
+                handler.telnetSend(side == Side::LOCAL ? TelnetCodec::WILL : TelnetCodec::DO, option);
+            }
+            break;
+        case YES:
+            if (!enable) {
+                state = WANTNO;
+                handler.telnetSend(side == Side::LOCAL ? TelnetCodec::WONT : TelnetCodec::DONT, option);
+            }
+            break;
+        case WANTNO:
+            // The opposite request is sent, as soon as the client has answered
+            if (enable != queued) state = WANTNO | (enable ? OPPOSITE : 0);
+            break;
+        case WANTYES:
+            if (enable == queued) state = WANTYES | (enable ? 0 : OPPOSITE);
+            break;
+        default:
+            break;
+    }
+}
+
+bool TelnetOptions::isEnabled(Side side, uint8_t option) const {
+    const auto index = indexOf(option);
+    if (index == OPTION_COUNT) return false;
+    const auto state = states[static_cast<size_t>(side)][index] & STATE_MASK;
+    return state == YES || state == WANTNO;
+}
+
+void TelnetOptions::reset() {
+    for (auto &side: states) {
+        for (auto &state: side) {
+            state = NO;
+        }
+    }
+}
+
+size_t TelnetOptions::indexOf(uint8_t option) {
+    for (size_t i = 0; i < OPTION_COUNT; i++) {
+        if (OPTIONS[i] == option) return i;
+    }
+    return OPTION_COUNT;
+}
@@ -0,0 +1,137 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBSMART_STM32NETXTELNET_TELNETOPTIONS_HPP
+#define LIBSMART_STM32NETXTELNET_TELNETOPTIONS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Stm32NetXTelnet {
+    /**
+     * @brief Telnet option negotiation of one connection with the Q method (RFC 1143).
+     *
+     * Keeps the state of both sides of every supported option, so requests are never repeated and
+     * negotiation loops can not occur. Unsupported options are refused without keeping any state.
+     */
+    class TelnetOptions {
+    public:
+        static constexpr uint8_t OPTION_BINARY = 0;
+        static constexpr uint8_t OPTION_ECHO = 1;
+        static constexpr uint8_t OPTION_SGA = 3;
+        static constexpr uint8_t OPTION_TTYPE = 24;
+        static constexpr uint8_t OPTION_NAWS = 31;
+        static constexpr uint8_t OPTION_LINEMODE = 34;
+
+        static constexpr uint8_t TTYPE_IS = 0;
+        static constexpr uint8_t TTYPE_SEND = 1;
+
+        static constexpr uint8_t LINEMODE_MODE = 1;
+        static constexpr uint8_t LINEMODE_FORWARDMASK = 2;
+        static constexpr uint8_t LINEMODE_SLC = 3;
+        static constexpr uint8_t MODE_EDIT = 1;
+        static constexpr uint8_t MODE_TRAPSIG = 2;
+        static constexpr uint8_t MODE_ACK = 4;
+
+        /**
+         * @brief The side of an option: LOCAL is the server (us), REMOTE the client (him).
+         */
+        enum class Side : uint8_t {
+            LOCAL, REMOTE
+        };
+
+        /**
+         * @brief Decides about options and sends the negotiation.
+         */
+        class Handler {
+        public:
+            virtual ~Handler() = default;
+
+            /**
+             * @brief Returns true, if the option may be enabled, when the client asks for it.
+             *
+             * @param side LOCAL for DO received, REMOTE for WILL received.
+             * @param option The option code.
+             */
+            virtual bool telnetAccept(Side side, uint8_t option) = 0;
+
+            /**
+             * @brief Called when an option has been enabled or disabled.
+             *
+             * @param side The side of the option.
+             * @param option The option code.
+             * @param enabled true, if the option is enabled now.
+             */
+            virtual void telnetChanged(Side /* side */, uint8_t /* option */, bool /* enabled */) { ; }
+
+            /**
+             * @brief Sends a negotiation to the client.
+             *
+             * @param verb WILL, WONT, DO or DONT.
+             * @param option The option code.
+             */
+            virtual void telnetSend(uint8_t verb, uint8_t option) = 0;
+        };
+
+        /**
+         * @brief Handles a negotiation received from the client.
+         *
+         * @param verb WILL, WONT, DO or DONT.
+         * @param option The option code.
+         * @param handler The handler for decisions and replies.
+         */
+        void receive(uint8_t verb, uint8_t option, Handler &handler);
+
+        /**
+         * @brief Asks the client to enable or disable an option.
+         *
+         * A request that is pending already or does not change the state is not sent again.
+         *
+         * @param side LOCAL to send WILL/WONT, REMOTE to send DO/DONT.
+         * @param option The option code, which must be supported.
+         * @param enable true to enable the option.
+         * @param handler The handler for replies.
+         */
+        void request(Side side, uint8_t option, bool enable, Handler &handler);
+
+        /**
+         * @brief Returns true, if the option is enabled on the given side.
+         */
+        bool isEnabled(Side side, uint8_t option) const;
+
+        /**
+         * @brief Disables all options for a new connection.
+         */
+        void reset();
+
+    private:
+        // State of one side of an option, the queue bit marks a pending opposite request
+        static constexpr uint8_t NO = 0;
+        static constexpr uint8_t YES = 1;
+        static constexpr uint8_t WANTNO = 2;
+        static constexpr uint8_t WANTYES = 3;
+        static constexpr uint8_t STATE_MASK = 0x03;
+        static constexpr uint8_t OPPOSITE = 0x04;
+
+        static constexpr uint8_t OPTIONS[] = {
+            OPTION_BINARY, OPTION_ECHO, OPTION_SGA, OPTION_TTYPE, OPTION_NAWS, OPTION_LINEMODE
+        };
+        static constexpr size_t OPTION_COUNT = sizeof(OPTIONS) / sizeof(OPTIONS[0]);
+
+        /**
+         * @brief Returns the index of a supported option or OPTION_COUNT.
+         */
+        static size_t indexOf(uint8_t option);
+
+        /**
+         * @brief Runs the Q method for a WILL/DO (enable) or WONT/DONT (disable) received.
+         */
+        static void receive(uint8_t &state, Side side, uint8_t option, bool enable, Handler &handler);
+
+        uint8_t states[2][OPTION_COUNT]{};
+    };
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#include "TxPacket.hpp"
+#include "Stm32NetX.hpp"
+
+size_t Stm32NetXTelnet::TxPacket::getWriteBuffer(uint8_t *&buffer) {
+    if (packet == nullptr && !allocate()) {
+        buffer = nullptr;
+        return 0;
+    }
+    buffer = packet->nx_packet_append_ptr;
+    return availableForWrite();
+}
+
+size_t Stm32NetXTelnet::TxPacket::setWrittenBytes(size_t size) {
+    if (packet == nullptr) return 0;
+    if (size > availableForWrite()) size = availableForWrite();
+    packet->nx_packet_append_ptr += size;
+    packet->nx_packet_length += size;
+    return size;
+}
+
+size_t Stm32NetXTelnet::TxPacket::write(uint8_t data) {
+    uint8_t *buffer{};
+    if (getWriteBuffer(buffer) == 0) return 0;
+    *buffer = data;
+    return setWrittenBytes(1);
+}
+
+size_t Stm32NetXTelnet::TxPacket::availableForWrite() {
+    if (packet == nullptr) return 0;
+    size_t space = packet->nx_packet_data_end - packet->nx_packet_append_ptr;
+    if (maxPayload > 0) {
+        const size_t mss = maxPayload > packet->nx_packet_length ? maxPayload - packet->nx_packet_length : 0;
+        if (mss < space) space = mss;
+    }
+    return space;
+}
+
+size_t Stm32NetXTelnet::TxPacket::available() const {
+    return packet == nullptr ? 0 : packet->nx_packet_length;
+}
+
+void Stm32NetXTelnet::TxPacket::clear() {
+    if (packet != nullptr) {
+        nx_packet_release(packet);
+        packet = nullptr;
+    }
+}
+
+NX_PACKET *Stm32NetXTelnet::TxPacket::getPacket() const {
+    return available() == 0 ? nullptr : packet;
+}
+
+bool Stm32NetXTelnet::TxPacket::allocate() {
+    // Never block the writer, the next call simply tries again
+    auto pool = packetPool != nullptr ? packetPool : Stm32NetX::NX->getPacketPool();
+    return nx_packet_allocate(pool, &packet, NX_TCP_PACKET, NX_NO_WAIT) == NX_SUCCESS;
+}
@@ -0,0 +1,114 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBSMART_STM32NETXTELNET_TXPACKET_HPP
+#define LIBSMART_STM32NETXTELNET_TXPACKET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "nx_api.h"
+
+namespace Stm32NetXTelnet {
+    class Server;
+
+    /**
+     * @brief Transmit packet a session writes its output into.
+     *
+     * Holds a pre-allocated NX_PACKET and hands out the free space behind its append pointer, so
+     * output is formatted directly into the payload that is later sent by the Server.
+     */
+    class TxPacket {
+    public:
+        friend Server;
+
+        TxPacket() = default;
+
+        TxPacket(const TxPacket &) = delete;
+
+        TxPacket &operator=(const TxPacket &) = delete;
+
+        ~TxPacket() { clear(); }
+
+        /**
+         * @brief Returns a pointer to the free payload space of the packet.
+         *
+         * Allocates a new packet, if none is held at the moment.
+         *
+         * @param buffer Reference to a pointer which is set to the first free byte.
+         *
+         * @return Number of bytes that can be written to buffer, 0 if no packet is available.
+         */
+        size_t getWriteBuffer(uint8_t *&buffer);
+
+        /**
+         * @brief Commits bytes written to the buffer returned by getWriteBuffer().
+         *
+         * @param size Number of bytes written.
+         *
+         * @return Number of bytes added to the packet.
+         */
+        size_t setWrittenBytes(size_t size);
+
+        /**
+         * @brief Appends a single byte to the packet.
+         *
+         * @param data The byte to append.
+         *
+         * @return 1 on success, 0 if the packet is full or no packet is available.
+         */
+        size_t write(uint8_t data);
+
+        /**
+         * @brief Returns the number of bytes that still fit into the packet.
+         */
+        size_t availableForWrite();
+
+        /**
+         * @brief Returns the number of bytes waiting in the packet.
+         */
+        size_t available() const;
+
+        /**
+         * @brief Releases the packet and any data written to it.
+         */
+        void clear();
+
+        /**
+         * @brief Sets the maximum payload size of a packet, e.g. the MSS of the peer.
+         *
+         * @param size Maximum number of payload bytes, 0 to use the full packet.
+         */
+        void setMaxPayload(ULONG size) { maxPayload = size; }
+
+        /**
+         * @brief Sets the pool new packets are allocated from.
+         *
+         * @param pool The packet pool or nullptr to use the packet pool of the IP instance.
+         */
+        void setPacketPool(NX_PACKET_POOL *pool) { packetPool = pool; }
+
+    protected:
+        /**
+         * @brief Returns the packet, if it holds data to send.
+         *
+         * @return The packet or nullptr, if there is no data to send.
+         */
+        NX_PACKET *getPacket() const;
+
+        /**
+         * @brief Forgets the packet after its ownership was passed to NetX by a successful send.
+         */
+        void detach() { packet = nullptr; }
+
+    private:
+        bool allocate();
+
+        NX_PACKET *packet{};
+        ULONG maxPayload{};
+        NX_PACKET_POOL *packetPool{};
+    };
+}
+
+#endif
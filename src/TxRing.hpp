@@ -0,0 +1,185 @@
+/*
+ * SPDX-FileCopyrightText: 2024 Roland Rusch, easy-smart solution GmbH <roland.rusch@easy-smart.ch>
+ * SPDX-License-Identifier: BSD-3-Clause
+ */
+
+#ifndef LIBSMART_STM32NETXTELNET_TXRING_HPP
+#define LIBSMART_STM32NETXTELNET_TXRING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace Stm32NetXTelnet {
+    /**
+     * @brief Bounded lock-free ring buffer with many writers and a single reader.
+     *
+     * Writers reserve a contiguous span, fill it and commit it. The reader sees committed data only,
+     * as soon as no writer is active anymore, and reads it in at most two segments, so data is never
+     * moved inside the buffer.
+     *
+     * Head position, committed position, number of active writers and the open reservation flag share
+     * one atomic word, so reserving and committing are a single compare-and-swap each. The last active
+     * writer, that commits, publishes everything reserved up to then.
+     *
+     * @tparam N Size of the buffer, must be a power of 2 of at most 4096 bytes.
+     */
+    template<size_t N>
+    class TxRing {
+        static_assert(N > 0 && (N & (N - 1)) == 0, "TxRing size must be a power of 2");
+        static_assert(N <= 4096, "TxRing size must not exceed 4096 bytes");
+
+    public:
+        /**
+         * @brief Reserves up to size contiguous bytes.
+         *
+         * The span may be shorter than requested, if the buffer is nearly full or wraps around.
+         * Every successful reservation must be committed with commit().
+         *
+         * @param span Reference to a pointer which is set to the reserved bytes.
+         * @param size Number of bytes to reserve.
+         *
+         * @return Number of bytes reserved, 0 if the buffer is full or blocked by an open reservation.
+         */
+        size_t reserve(uint8_t *&span, size_t size) { return acquire(span, size, false); }
+
+        /**
+         * @brief Publishes a span reserved with reserve(), all bytes of which must have been written.
+         */
+        void commit() { release(0, false); }
+
+        /**
+         * @brief Reserves all contiguous free space for a writer, that does not know its size in advance.
+         *
+         * No other writer can reserve space until the reservation is committed with commitAll(), which
+         * gives back the unused bytes.
+         *
+         * @param span Reference to a pointer which is set to the reserved bytes.
+         *
+         * @return Number of bytes reserved, 0 if the buffer is full or blocked by an open reservation.
+         */
+        size_t reserveAll(uint8_t *&span) { return acquire(span, N, true); }
+
+        /**
+         * @brief Publishes the used part of a span reserved with reserveAll().
+         *
+         * @param reserved The number of bytes reserved.
+         * @param used The number of bytes written.
+         */
+        void commitAll(size_t reserved, size_t used) {
+            // The open reservation is always the last one, so its unused tail simply goes back
+            release(used < reserved ? reserved - used : 0, true);
+        }
+
+        /**
+         * @brief Returns true, if writers have to wait for an open reservation.
+         */
+        bool isBlocked() const { return (state.load(std::memory_order_relaxed) & OPEN) != 0; }
+
+        /**
+         * @brief Returns the committed data in at most two segments. Reader only.
+         *
+         * @param first Reference to a pointer which is set to the oldest byte.
+         * @param szFirst Reference to the number of bytes at first.
+         * @param second Reference to a pointer which is set to the data behind the wrap around.
+         * @param szSecond Reference to the number of bytes at second.
+         *
+         * @return Number of bytes in both segments.
+         */
+        size_t peek(const uint8_t *&first, size_t &szFirst, const uint8_t *&second, size_t &szSecond) {
+            const auto size = available();
+            const auto index = tail.load(std::memory_order_relaxed) & (N - 1);
+            first = buffer + index;
+            szFirst = size < N - index ? size : N - index;
+            second = buffer;
+            szSecond = size - szFirst;
+            return size;
+        }
+
+        /**
+         * @brief Frees bytes that have been sent. Reader only.
+         *
+         * @param size Number of bytes to free.
+         */
+        void remove(size_t size) {
+            const auto avail = available();
+            if (size > avail) size = avail;
+            tail.store((tail.load(std::memory_order_relaxed) + size) & POS_MASK, std::memory_order_release);
+        }
+
+        /**
+         * @brief Returns the number of committed bytes. Reader only.
+         */
+        size_t available() {
+            const auto committed = (state.load(std::memory_order_acquire) >> COMMITTED_SHIFT) & POS_MASK;
+            return (committed - tail.load(std::memory_order_relaxed)) & POS_MASK;
+        }
+
+        /**
+         * @brief Returns the number of free bytes.
+         */
+        size_t availableForWrite() const {
+            const auto head = state.load(std::memory_order_relaxed) & POS_MASK;
+            return N - ((head - tail.load(std::memory_order_acquire)) & POS_MASK);
+        }
+
+        /**
+         * @brief Drops all data. Reader only.
+         */
+        void clear() {
+            const auto committed = (state.load(std::memory_order_acquire) >> COMMITTED_SHIFT) & POS_MASK;
+            tail.store(committed, std::memory_order_release);
+        }
+
+    private:
+        // Positions count modulo 2 * N at most, which tells a full from an empty buffer
+        static constexpr uint32_t POS_MASK = 0x1fff;
+        static constexpr uint32_t COMMITTED_SHIFT = 13;
+        static constexpr uint32_t WRITER = 1ul << 26;
+        static constexpr uint32_t WRITER_MASK = 0x1ful << 26;
+        static constexpr uint32_t OPEN = 1ul << 31;
+
+        void release(size_t unused, bool open) {
+            auto old = state.load(std::memory_order_relaxed);
+            uint32_t next;
+            do {
+                const auto head = (old - static_cast<uint32_t>(unused)) & POS_MASK;
+                const auto writers = (old & WRITER_MASK) - WRITER;
+                auto committed = (old >> COMMITTED_SHIFT) & POS_MASK;
+                if (writers == 0) {
+                    committed = head;
+                }
+                next = (old & (open ? 0 : OPEN)) | writers | (committed << COMMITTED_SHIFT) | head;
+            } while (!state.compare_exchange_weak(old, next, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+        size_t acquire(uint8_t *&span, size_t size, bool open) {
+            auto old = state.load(std::memory_order_relaxed);
+            for (;;) {
+                span = nullptr;
+                if ((old & OPEN) != 0 || (old & WRITER_MASK) == WRITER_MASK) {
+                    return 0;
+                }
+                const auto head = old & POS_MASK;
+                const size_t free = N - ((head - tail.load(std::memory_order_acquire)) & POS_MASK);
+                const size_t contiguous = N - (head & (N - 1));
+                size_t n = size < free ? size : free;
+                if (contiguous < n) n = contiguous;
+                if (n == 0) {
+                    return 0;
+                }
+                const auto next = ((old & ~POS_MASK) + WRITER) | ((head + n) & POS_MASK) | (open ? OPEN : 0);
+                if (state.compare_exchange_weak(old, next, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    span = buffer + (head & (N - 1));
+                    return n;
+                }
+            }
+        }
+
+        std::atomic<uint32_t> state{0};
+        std::atomic<uint32_t> tail{0};
+        uint8_t buffer[N]{};
+    };
+}
+
+#endif
@@ -9,7 +9,11 @@
 #define LIBSMART_STM32NETXTELNET
 
 /**
- * Maximum number of connections the telnet server handles
+ * Default number of connections of a StaticServer.
+ * The session manager of a server must hold as many sessions as the server has connections.
+ * StaticServer needs NX_TELNET_SERVER_USER_CLIENT_LIST in nx_user.h, which is seen by the NetX Duo
+ * telnet server as well. Otherwise every server holds a client list of NX_TELNET_MAX_CLIENTS clients
+ * in addition to its own.
  */
 #define LIBSMART_STM32NETXTELNET_SERVER_MAX_CONNECTIONS 4
 
@@ -21,8 +25,91 @@
 
 
 /**
- * Size of the tx buffer per telnet logicalConnection
+ * Number of received packets queued per telnet logicalConnection, must be a power of 2.
+ * While the queue is full, data is left on the socket, which closes the TCP receive window.
+ */
+#define LIBSMART_STM32NETXTELNET_RX_QUEUE_DEPTH 4
+
+
+/**
+ * Maximum size of the parameters of a telnet subnegotiation (IAC SB ... IAC SE).
+ * Longer subnegotiations are discarded.
+ */
+#define LIBSMART_STM32NETXTELNET_SB_BUFFER_SIZE 32
+
+
+/**
+ * Size of the buffer per telnet logicalConnection, that holds the replies to telnet commands,
+ * until the server sends them.
+ */
+#define LIBSMART_STM32NETXTELNET_NEGOTIATION_BUFFER_SIZE 128
+
+
+/**
+ * Maximum length of an input line and maximum number of tokens in it, for sessions that bypass
+ * microrl, i.e. raw TCP sessions and clients in LINEMODE.
+ */
+#define LIBSMART_STM32NETXTELNET_LINE_SIZE 128
+#define LIBSMART_STM32NETXTELNET_LINE_MAX_TOKENS 16
+
+
+/**
+ * If defined, sessions parse their input directly from the received packets instead of the rx buffer,
+ * which saves one copy of every input byte. LIBSMART_STM32NETXTELNET_BUFFER_SIZE_RX may be reduced then.
+ */
+// #define LIBSMART_STM32NETXTELNET_ZERO_COPY_RX
+
+
+/**
+ * Size of the tx buffer or tx ring per telnet logicalConnection.
+ * Output is sent in segments of the peer MSS, so it may be raised to several KB for bulk output.
  */
 #define LIBSMART_STM32NETXTELNET_BUFFER_SIZE_TX 256
 
+
+/**
+ * Size of the scratch buffer output of Server::broadcast() is formatted into, before it is copied to the sessions
+ */
+#define LIBSMART_STM32NETXTELNET_BUFFER_SIZE_BROADCAST 256
+
+
+/**
+ * Pending output of a session is sent when at least this many bytes are waiting
+ * and the peer has acknowledged everything sent before
+ */
+#define LIBSMART_STM32NETXTELNET_TX_LOW_WATERMARK 64
+
+
+/**
+ * Pending output of a session is sent immediately when at least this many bytes are waiting
+ */
+#define LIBSMART_STM32NETXTELNET_TX_HIGH_WATERMARK (LIBSMART_STM32NETXTELNET_BUFFER_SIZE_TX / 2)
+
+
+/**
+ * Maximum number of ticks output of a session is held back to coalesce small writes, 0 to disable
+ */
+#define LIBSMART_STM32NETXTELNET_TX_MAX_DELAY 5
+
+
+/**
+ * If defined, sessions write their output directly into a pre-allocated NX_PACKET
+ * instead of the tx buffer, which saves one copy of every output byte
+ */
+// #define LIBSMART_STM32NETXTELNET_ZERO_COPY_TX
+
+
+/**
+ * If defined, sessions write their output into a lock-free ring buffer, which is safe for
+ * concurrent writers like command workers and the echo of the command line.
+ * LIBSMART_STM32NETXTELNET_BUFFER_SIZE_TX must be a power of 2.
+ * Can not be used together with LIBSMART_STM32NETXTELNET_ZERO_COPY_TX.
+ */
+// #define LIBSMART_STM32NETXTELNET_TX_RING
+
+/**
+ * Message sent to a client, that is rejected because all sessions are in use.
+ */
+#define LIBSMART_STM32NETXTELNET_BUSY_MESSAGE "Server busy, try again later.\r\n"
+
 #endif
@@ -43,6 +43,136 @@ NX_CALLER_CHECKING_EXTERNS
 
 
 
+#ifndef NX_TELNET_SERVER_USER_CLIENT_LIST
+
+#endif /* NX_TELNET_SERVER_USER_CLIENT_LIST */
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nxe_telnet_server_create_extended                  PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function checks for errors in the TELNET server create with a  */ 
+/*    client list of the application call.                                */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    server_name                           Name of TELNET server         */ 
+/*    ip_ptr                                Pointer to IP instance        */ 
+/*    stack_ptr                             Server thread's stack pointer */ 
+/*    stack_size                            Server thread's stack size    */ 
+/*    client_list                           Client requests of the server */ 
+/*    max_clients                           Number of client requests     */ 
+/*    window_size                           TCP receive window size       */ 
+/*    new_connection                        Pointer to user's new         */ 
+/*                                            connection function         */ 
+/*    receive_data                          Pointer to user's receive     */ 
+/*                                            data function               */ 
+/*    connection_end                        Pointer to user's end of      */ 
+/*                                            connection function         */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    status                                Completion status             */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_create_extended     Actual server create call     */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nxe_telnet_server_create_extended(NX_TELNET_SERVER *server_ptr, CHAR *server_name, NX_IP *ip_ptr, VOID *stack_ptr, ULONG stack_size, 
+            NX_TELNET_CLIENT_REQUEST *client_list, UINT max_clients, ULONG window_size,
+            void (*new_connection)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection), 
+            void (*receive_data)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection, NX_PACKET *packet_ptr),
+            void (*connection_end)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection))
+{
+
+UINT        status;
+
+
+    /* Check for invalid input pointers.  */
+    if ((ip_ptr == NX_NULL) || (ip_ptr -> nx_ip_id != NX_IP_ID) || 
+        (server_ptr == NX_NULL) || (server_ptr -> nx_telnet_server_id == NX_TELNET_SERVER_ID) || 
+        (stack_ptr == NX_NULL) || (client_list == NX_NULL) ||
+        (new_connection == NX_NULL) || (receive_data == NX_NULL) || (connection_end == NX_NULL))
+        return(NX_PTR_ERROR);
+
+    /* Check for a client list, that the socket bitmaps can hold, and a usable window.  */
+    if ((max_clients == 0) || (max_clients > NX_TELNET_SERVER_CLIENTS_LIMIT) || (window_size == 0))
+        return(NX_SIZE_ERROR);
+
+    /* Call actual server create function.  */
+    status =  _nx_telnet_server_create_extended(server_ptr, server_name, ip_ptr, stack_ptr, stack_size, client_list, max_clients, window_size,
+                                                new_connection, receive_data, connection_end);
+
+    /* Return completion status.  */
+    return(status);
+}
+
+
+#ifndef NX_TELNET_SERVER_USER_CLIENT_LIST
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_create                            PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function creates a TELNET server with the client list inside   */ 
+/*    the server structure, NX_TELNET_MAX_CLIENTS clients and a window    */ 
+/*    of NX_TELNET_SERVER_WINDOW_SIZE bytes.                              */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    server_name                           Name of TELNET server         */ 
+/*    ip_ptr                                Pointer to IP instance        */ 
+/*    stack_ptr                             Server thread's stack pointer */ 
+/*    stack_size                            Server thread's stack size    */ 
+/*    new_connection                        Pointer to user's new         */ 
+/*                                            connection function         */ 
+/*    receive_data                          Pointer to user's receive     */ 
+/*                                            data function               */ 
+/*    connection_end                        Pointer to user's end of      */ 
+/*                                            connection function         */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    status                                Completion status             */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_create_extended     Actual server create call     */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nx_telnet_server_create(NX_TELNET_SERVER *server_ptr, CHAR *server_name, NX_IP *ip_ptr, VOID *stack_ptr, ULONG stack_size, 
+            void (*new_connection)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection), 
+            void (*receive_data)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection, NX_PACKET *packet_ptr),
+            void (*connection_end)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection))
+{
+
+    /* Create the server with the client list inside the server structure.  */
+    return(_nx_telnet_server_create_extended(server_ptr, server_name, ip_ptr, stack_ptr, stack_size, 
+                                             server_ptr -> nx_telnet_server_client_area, NX_TELNET_MAX_CLIENTS, 
+                                             NX_TELNET_SERVER_WINDOW_SIZE, new_connection, receive_data, connection_end));
+}
+#endif /* NX_TELNET_SERVER_USER_CLIENT_LIST */
+
+
 /**************************************************************************/ 
 /*                                                                        */ 
 /*  FUNCTION                                               RELEASE        */ 
@@ -120,7 +250,7 @@ UINT        status;
 /*                                                                        */ 
 /*  FUNCTION                                               RELEASE        */ 
 /*                                                                        */ 
-/*    _nx_telnet_server_create                           PORTABLE C       */ 
+/*    _nx_telnet_server_create_extended                  PORTABLE C       */ 
 /*                                                           6.1          */
 /*  AUTHOR                                                                */
 /*                                                                        */
@@ -140,6 +270,9 @@ UINT        status;
 /*    ip_ptr                                Pointer to IP instance        */ 
 /*    stack_ptr                             Server thread's stack pointer */ 
 /*    stack_size                            Server thread's stack size    */ 
+/*    client_list                           Client requests of the server */ 
+/*    max_clients                           Number of client requests     */ 
+/*    window_size                           TCP receive window size       */ 
 /*    new_connection                        Pointer to user's new         */ 
 /*                                            connection function         */ 
 /*    receive_data                          Pointer to user's receive     */ 
@@ -177,7 +310,8 @@ UINT        status;
 /*                                            resulting in version 6.1    */
 /*                                                                        */
 /**************************************************************************/
-UINT  _nx_telnet_server_create(NX_TELNET_SERVER *server_ptr, CHAR *server_name, NX_IP *ip_ptr, VOID *stack_ptr, ULONG stack_size, 
+UINT  _nx_telnet_server_create_extended(NX_TELNET_SERVER *server_ptr, CHAR *server_name, NX_IP *ip_ptr, VOID *stack_ptr, ULONG stack_size, 
+            NX_TELNET_CLIENT_REQUEST *client_list, UINT max_clients, ULONG window_size,
             void (*new_connection)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection), 
             void (*receive_data)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection, NX_PACKET *packet_ptr),
             void (*connection_end)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection))
@@ -186,8 +320,29 @@ UINT  _nx_telnet_server_create(NX_TELNET_SERVER *server_ptr, CHAR *server_name,
 UINT            i;
 UINT            status;
 
-    /* Clear the TELNET server structure.  */
+    /* Clear the TELNET server structure and the client list.  */
     memset((void *) server_ptr, 0, sizeof(NX_TELNET_SERVER));
+    memset((void *) client_list, 0, max_clients * sizeof(NX_TELNET_CLIENT_REQUEST));
+    server_ptr -> nx_telnet_server_client_list =  client_list;
+    server_ptr -> nx_telnet_server_max_clients =  max_clients;
+
+    /* Listen on the default TELNET port with all clients, unless the application changes it before the start.  */
+    server_ptr -> nx_telnet_server_listeners[0].nx_telnet_listener_port =  NX_TELNET_SERVER_PORT;
+    server_ptr -> nx_telnet_server_listeners[0].nx_telnet_listener_first_client =  0;
+    server_ptr -> nx_telnet_server_listeners[0].nx_telnet_listener_max_clients =  max_clients;
+    server_ptr -> nx_telnet_server_listener_count =  1;
+
+    /* Apply the default activity timeout to new connections.  */
+    server_ptr -> nx_telnet_server_activity_timeout =  NX_TELNET_ACTIVITY_TIMEOUT * NX_IP_PERIODIC_RATE;
+
+    /* Close connections gracefully by default.  */
+    server_ptr -> nx_telnet_server_close_policy =  NX_TELNET_CLOSE_GRACEFUL;
+    server_ptr -> nx_telnet_server_close_timeout =  NX_TELNET_SERVER_CLOSE_TIMEOUT;
+
+    /* Limit the rate of new connections.  */
+    server_ptr -> nx_telnet_server_rate_burst =  NX_TELNET_SERVER_RATE_BURST;
+    server_ptr -> nx_telnet_server_rate_refill =  NX_TELNET_SERVER_RATE_REFILL;
+    server_ptr -> nx_telnet_server_rate_global =  NX_TELNET_SERVER_RATE_GLOBAL;
 
     /* Create the TELNET Server thread.  */
     status =  tx_thread_create(&(server_ptr -> nx_telnet_server_thread), "TELNET Server Thread", 
@@ -217,12 +372,11 @@ UINT            status;
         return(status);
     }
 
-    /* Create the ThreadX activity timeout timer.  This will be used to periodically check to see if 
-       a client connection has gone silent and needs to be terminated.  */
+    /* Create the ThreadX activity timeout timer.  This one-shot timer expires at the nearest deadline
+       of all client connections, so a connection that has gone silent is terminated on time.  */
     status =  tx_timer_create(&(server_ptr -> nx_telnet_server_timer), "TELNET Server Timer", 
                               _nx_telnet_server_timeout, (ULONG) server_ptr, 
-                              (NX_IP_PERIODIC_RATE * NX_TELNET_TIMEOUT_PERIOD), 
-                              (NX_IP_PERIODIC_RATE * NX_TELNET_TIMEOUT_PERIOD), TX_NO_ACTIVATE);
+                              (NX_IP_PERIODIC_RATE * NX_TELNET_TIMEOUT_PERIOD), 0, TX_NO_ACTIVATE);
 
     /* Determine if an error occurred creating the timer.  */
     if (status != TX_SUCCESS)
@@ -239,7 +393,7 @@ UINT            status;
     }
 
     /* Loop to create all the TELNET client sockets.  */
-    for (i = 0; i < NX_TELNET_MAX_CLIENTS; i++)
+    for (i = 0; i < server_ptr -> nx_telnet_server_max_clients; i++)
     {
 
         /* Setup the logical index for this client request structure.  */
@@ -247,7 +401,7 @@ UINT            status;
 
         /* Create an TELNET client socket.  */
         status +=  nx_tcp_socket_create(ip_ptr, &(server_ptr -> nx_telnet_server_client_list[i].nx_telnet_client_request_socket), "TELNET Server Control Socket",
-                        NX_TELNET_TOS, NX_TELNET_FRAGMENT_OPTION, NX_TELNET_TIME_TO_LIVE, NX_TELNET_SERVER_WINDOW_SIZE, NX_NULL, _nx_telnet_server_disconnect_present);
+                        NX_TELNET_TOS, NX_TELNET_FRAGMENT_OPTION, NX_TELNET_TIME_TO_LIVE, window_size, NX_NULL, _nx_telnet_server_disconnect_present);
 
         /* If no error is present, register the receive notify function.  */
         if (status == NX_SUCCESS)
@@ -256,6 +410,16 @@ UINT            status;
             /* Register the receive function.  */
             nx_tcp_socket_receive_notify(&(server_ptr -> nx_telnet_server_client_list[i].nx_telnet_client_request_socket), 
                                             _nx_telnet_server_data_present);
+#ifdef NX_ENABLE_EXTENDED_NOTIFY_SUPPORT
+
+            /* Register the function, that signals a completed handshake.  */
+            nx_tcp_socket_establish_notify(&(server_ptr -> nx_telnet_server_client_list[i].nx_telnet_client_request_socket), 
+                                           _nx_telnet_server_establish_present);
+
+            /* A finished FIN exchange is signalled like a disconnect.  */
+            nx_tcp_socket_disconnect_complete_notify(&(server_ptr -> nx_telnet_server_client_list[i].nx_telnet_client_request_socket), 
+                                                     _nx_telnet_server_disconnect_present);
+#endif /* NX_ENABLE_EXTENDED_NOTIFY_SUPPORT */
         }
 
         /* Make sure each socket points to the TELNET server.  */
@@ -267,7 +431,7 @@ UINT            status;
     {
 
         /* Loop to delete any created sockets.  */
-        for (i = 0; i < NX_TELNET_MAX_CLIENTS; i++)
+        for (i = 0; i < server_ptr -> nx_telnet_server_max_clients; i++)
         {
 
             /* Delete the TELNET socket.  */
@@ -301,7 +465,7 @@ UINT            status;
     if (status != NX_SUCCESS)
     {
         /* Loop to delete any created sockets.  */
-        for (i = 0; i < NX_TELNET_MAX_CLIENTS; i++)
+        for (i = 0; i < server_ptr -> nx_telnet_server_max_clients; i++)
         {
 
             /* Delete the TELNET socket.  */
@@ -497,7 +661,7 @@ NX_TELNET_CLIENT_REQUEST   *client_request_ptr;
     /* Walk through the server structure to close and delete any open sockets.  */
     i =  0;
     client_request_ptr =  &(server_ptr -> nx_telnet_server_client_list[0]);
-    while (i < NX_TELNET_MAX_CLIENTS)
+    while (i < server_ptr -> nx_telnet_server_max_clients)
     {
 
         /* Disconnect the socket.  */
@@ -514,8 +678,13 @@ NX_TELNET_CLIENT_REQUEST   *client_request_ptr;
         i++;
     }
 
-    /* Unlisten on the TELNET port.  */
-    nx_tcp_server_socket_unlisten(server_ptr -> nx_telnet_server_ip_ptr, NX_TELNET_SERVER_PORT);
+    /* Unlisten on all TELNET ports.  */
+    for (i = 0; i < server_ptr -> nx_telnet_server_listener_count; i++)
+    {
+        server_ptr -> nx_telnet_server_listeners[i].nx_telnet_listener_socket_ptr =  NX_NULL;
+        nx_tcp_server_socket_unlisten(server_ptr -> nx_telnet_server_ip_ptr, 
+                                      server_ptr -> nx_telnet_server_listeners[i].nx_telnet_listener_port);
+    }
 
     /* Return successful completion.  */
     return(NX_SUCCESS);
@@ -575,7 +744,7 @@ UINT    status;
         return(NX_PTR_ERROR);
 
     /* Check for a valid logical connection.  */
-    if (logical_connection >= NX_TELNET_MAX_CLIENTS)
+    if (logical_connection >= server_ptr -> nx_telnet_server_max_clients)
         return(NX_OPTION_ERROR);
 
     /* Check for appropriate caller.  */
@@ -602,7 +771,9 @@ UINT    status;
 /*  DESCRIPTION                                                           */ 
 /*                                                                        */ 
 /*    This function processes server disconnect requests made by the      */ 
-/*    application receive data callback function.                         */ 
+/*    application receive data callback function. It returns at once,     */ 
+/*    the server thread closes the connection and calls the connection    */ 
+/*    end callback, when it is closed.                                    */ 
 /*                                                                        */ 
 /*  INPUT                                                                 */ 
 /*                                                                        */ 
@@ -615,9 +786,7 @@ UINT    status;
 /*                                                                        */ 
 /*  CALLS                                                                 */ 
 /*                                                                        */ 
-/*    nx_tcp_server_socket_relisten         Relisten on Telnet port       */ 
-/*    nx_tcp_server_socket_unaccept         Socket unaccept               */ 
-/*    nx_tcp_socket_disconnect              Socket disconnect             */ 
+/*    tx_event_flags_set                    Set events for server thread  */ 
 /*                                                                        */ 
 /*  CALLED BY                                                             */ 
 /*                                                                        */ 
@@ -639,72 +808,25 @@ UINT    status;
 UINT  _nx_telnet_server_disconnect(NX_TELNET_SERVER *server_ptr, UINT logical_connection)
 {
 
-UINT                        i;
-UINT                        status;
 NX_TELNET_CLIENT_REQUEST   *client_ptr;
 
     /* Set a pointer to the indicated client connection.  */
     client_ptr =  &(server_ptr -> nx_telnet_server_client_list[logical_connection]);
 
-    /* Determine if the connection is alive.  */
-    if (client_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state >= NX_TCP_ESTABLISHED)
-    {
-
-        /* Disconnect the socket.  */
-        nx_tcp_socket_disconnect(&(client_ptr -> nx_telnet_client_request_socket), NX_TELNET_SERVER_TIMEOUT);
-
-        /* Unaccept this socket.  */
-        nx_tcp_server_socket_unaccept(&(client_ptr -> nx_telnet_client_request_socket));
-
-        /* Update number of current open connections. */
-        if (server_ptr -> nx_telnet_server_open_connections > 0)
-            server_ptr -> nx_telnet_server_open_connections--;
-
-        /* Clear the client request activity timeout.  */
-        client_ptr -> nx_telnet_client_request_activity_timeout =  0;
-
-        /* Call the application's end connection callback routine.  */
-        if (server_ptr -> nx_telnet_connection_end)
-        {
-
-            /* Yes, there is a connection end callback routine - call it!  */
-            (server_ptr -> nx_telnet_connection_end)(server_ptr, client_ptr -> nx_telnet_client_request_connection);
-        }
-    }
-    else
+    /* Determine if the connection is alive and known to the application.  */
+    if ((client_ptr -> nx_telnet_client_request_state != NX_TELNET_CLIENT_CONNECTED) ||
+        (client_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state < NX_TCP_ESTABLISHED))
     {
 
         /* Error, disconnecting an unconnected socket.  */
         return(NX_TELNET_NOT_CONNECTED);
     }
 
-    /* Now look for a socket that is closed to relisten on.  */
-    for (i = 0; i < NX_TELNET_MAX_CLIENTS; i++)
-    {
-
-        /* Set a pointer to client request structure.  */
-        client_ptr =  &(server_ptr -> nx_telnet_server_client_list[i]);
-
-        /* Now see if this socket is closed.  */
-        if (client_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state == NX_TCP_CLOSED)
-        {
-
-            /* Relisten on this socket.  */
-            status =  nx_tcp_server_socket_relisten(server_ptr -> nx_telnet_server_ip_ptr, NX_TELNET_SERVER_PORT, 
-                                                    &(client_ptr -> nx_telnet_client_request_socket));
-            /* Check for bad status.  */
-            if ((status != NX_SUCCESS) && (status != NX_CONNECTION_PENDING))
-            {
-
-                /* Increment the error count and keep trying.  */
-                server_ptr -> nx_telnet_server_relisten_errors++;
-                continue;
-            }
-            
-            /* Break out of loop.  */
-            break;
-        }
-    }
+    /* Let the server thread close the connection, so the caller does not wait for the client.  The
+       application's end connection callback routine is called, when the connection is closed.  */
+    client_ptr -> nx_telnet_client_request_close_requested =  NX_TRUE;
+    _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_disconnect_pending, logical_connection);
+    tx_event_flags_set(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_SERVER_DISCONNECT, TX_OR);
 
     /* Return success.  */
     return(NX_SUCCESS);
@@ -766,7 +888,7 @@ UINT    status;
         return(NX_PTR_ERROR);
 
     /* Check for a valid logical connection.  */
-    if (logical_connection >= NX_TELNET_MAX_CLIENTS)
+    if (logical_connection >= server_ptr -> nx_telnet_server_max_clients)
         return(NX_OPTION_ERROR);
 
     /* Check for appropriate caller.  */
@@ -937,7 +1059,6 @@ UINT    status;
 /*                                                                        */ 
 /*    nx_tcp_server_socket_listen           Listen of TELNET clients      */ 
 /*    tx_thread_resume                      Resume TELNET server thread   */ 
-/*    tx_timer_activate                     Activate TELNET server timer  */ 
 /*                                                                        */ 
 /*  CALLED BY                                                             */ 
 /*                                                                        */ 
@@ -955,8 +1076,11 @@ UINT    status;
 UINT  _nx_telnet_server_start(NX_TELNET_SERVER *server_ptr)
 {
 
-UINT    status;
-ULONG   events;
+UINT                        i;
+UINT                        p;
+UINT                        status;
+ULONG                       events;
+NX_TELNET_SERVER_LISTENER  *listener_ptr;
 
 #ifndef NX_TELNET_SERVER_OPTION_DISABLE
 
@@ -969,21 +1093,55 @@ ULONG   events;
     }
 #endif
 
-    /* Start listening on the TELNET socket.  */
-    status =  nx_tcp_server_socket_listen(server_ptr -> nx_telnet_server_ip_ptr, NX_TELNET_SERVER_PORT, 
-                        &(server_ptr -> nx_telnet_server_client_list[0].nx_telnet_client_request_socket), 
-                                    NX_TELNET_MAX_CLIENTS, _nx_telnet_server_connection_present);
+    /* Forget the events of an earlier run, before the first connection can signal.  */
+    for (i = 0; i < NX_TELNET_SERVER_BITMAP_WORDS; i++)
+    {
+        server_ptr -> nx_telnet_server_connect_pending[i] =  0;
+        server_ptr -> nx_telnet_server_disconnect_pending[i] =  0;
+        server_ptr -> nx_telnet_server_data_pending[i] =  0;
+        server_ptr -> nx_telnet_server_closed[i] =  0;
+    }
+
+    /* Remember the port of each client, connections are dispatched by it.  */
+    for (p = 0; p < server_ptr -> nx_telnet_server_listener_count; p++)
+    {
+        listener_ptr =  &(server_ptr -> nx_telnet_server_listeners[p]);
+        for (i = 0; i < listener_ptr -> nx_telnet_listener_max_clients; i++)
+            server_ptr -> nx_telnet_server_client_list[listener_ptr -> nx_telnet_listener_first_client + i].nx_telnet_client_request_listener =  p;
+    }
 
-    /* Determine if an error is present.  */
-    if (status != NX_SUCCESS)
+    /* Start listening on the first TELNET socket of every port.  */
+    for (p = 0; p < server_ptr -> nx_telnet_server_listener_count; p++)
     {
+        listener_ptr =  &(server_ptr -> nx_telnet_server_listeners[p]);
+        status =  nx_tcp_server_socket_listen(server_ptr -> nx_telnet_server_ip_ptr, listener_ptr -> nx_telnet_listener_port, 
+                            &(server_ptr -> nx_telnet_server_client_list[listener_ptr -> nx_telnet_listener_first_client].nx_telnet_client_request_socket), 
+                                        listener_ptr -> nx_telnet_listener_max_clients, _nx_telnet_server_connection_present);
 
-        /* Error, return to caller.  */
-        return(status);
+        /* Determine if an error is present.  */
+        if (status != NX_SUCCESS)
+        {
+
+            /* Unlisten on the ports that listen already.  */
+            while (p-- > 0)
+            {
+                server_ptr -> nx_telnet_server_listeners[p].nx_telnet_listener_socket_ptr =  NX_NULL;
+                nx_tcp_server_socket_unlisten(server_ptr -> nx_telnet_server_ip_ptr, 
+                                              server_ptr -> nx_telnet_server_listeners[p].nx_telnet_listener_port);
+            }
+
+            /* Error, return to caller.  */
+            return(status);
+        }
+
+        listener_ptr -> nx_telnet_listener_socket_ptr =  &(server_ptr -> nx_telnet_server_client_list[listener_ptr -> nx_telnet_listener_first_client].nx_telnet_client_request_socket);
+
+        /* All other sockets of the port are closed, until they are needed to listen.  */
+        for (i = 1; i < listener_ptr -> nx_telnet_listener_max_clients; i++)
+            _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_closed, listener_ptr -> nx_telnet_listener_first_client + i);
     }
 
-    /* Activate TELNET server timer.  */
-    tx_timer_activate(&(server_ptr -> nx_telnet_server_timer));
+    /* The TELNET server timer is armed with the first client connection.  */
 
     /* Clear stop event. */
     tx_event_flags_get(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_STOP_EVENT, TX_OR_CLEAR, &events, TX_NO_WAIT);
@@ -1116,7 +1274,7 @@ NX_TELNET_CLIENT_REQUEST   *client_request_ptr;
     /* Walk through the server structure to close and delete any open sockets.  */
     i =  0;
     client_request_ptr =  &(server_ptr -> nx_telnet_server_client_list[0]);
-    while (i < NX_TELNET_MAX_CLIENTS)
+    while (i < server_ptr -> nx_telnet_server_max_clients)
     {
 
         /* Disconnect the socket.  */
@@ -1127,14 +1285,24 @@ NX_TELNET_CLIENT_REQUEST   *client_request_ptr;
 
         /* Reset client request. */
         client_request_ptr -> nx_telnet_client_request_activity_timeout =  0;
+        client_request_ptr -> nx_telnet_client_request_state =  NX_TELNET_CLIENT_CLOSED;
+        client_request_ptr -> nx_telnet_client_request_close_requested =  NX_FALSE;
+        client_request_ptr -> nx_telnet_client_request_close_abort =  NX_FALSE;
 
         /* Increment the pointer into the client request list.  */
         client_request_ptr++;
         i++;
     }
+    server_ptr -> nx_telnet_server_accepting =  0;
+    server_ptr -> nx_telnet_server_closing =  0;
 
-    /* Unlisten on the TELNET port.  */
-    nx_tcp_server_socket_unlisten(server_ptr -> nx_telnet_server_ip_ptr, NX_TELNET_SERVER_PORT);
+    /* Unlisten on all TELNET ports.  */
+    for (i = 0; i < server_ptr -> nx_telnet_server_listener_count; i++)
+    {
+        server_ptr -> nx_telnet_server_listeners[i].nx_telnet_listener_socket_ptr =  NX_NULL;
+        nx_tcp_server_socket_unlisten(server_ptr -> nx_telnet_server_ip_ptr, 
+                                      server_ptr -> nx_telnet_server_listeners[i].nx_telnet_listener_port);
+    }
 
     /* Return successful completion.  */
     return(NX_SUCCESS);
@@ -1307,6 +1475,9 @@ VOID  _nx_telnet_server_thread_entry(ULONG telnet_server)
 NX_TELNET_SERVER        *server_ptr;
 UINT                    status;
 ULONG                   events;
+ULONG                   wait_option;
+UINT                    i;
+UINT                    state;
 
 
     /* Setup the server pointer.  */
@@ -1316,8 +1487,31 @@ ULONG                   events;
     while(1)
     {
 
-        /* Wait for an TELNET client activity.  */
-        status =  tx_event_flags_get(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_ANY_EVENT, TX_OR_CLEAR, &events, TX_WAIT_FOREVER);
+        /* Wait for an TELNET client activity.  Closes, that wait for output to be acknowledged, and handshakes
+           without establish notify are checked periodically, as NetX does not signal them.  */
+        wait_option =  TX_WAIT_FOREVER;
+        if (server_ptr -> nx_telnet_server_closing)
+            wait_option =  NX_TELNET_SERVER_POLL_PERIOD;
+#ifndef NX_ENABLE_EXTENDED_NOTIFY_SUPPORT
+        if (server_ptr -> nx_telnet_server_accepting)
+            wait_option =  NX_TELNET_SERVER_POLL_PERIOD;
+#endif /* NX_ENABLE_EXTENDED_NOTIFY_SUPPORT */
+        status =  tx_event_flags_get(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_ANY_EVENT, TX_OR_CLEAR, &events, wait_option);
+
+        /* Look at the handshakes and closes in progress, when no event came in time.  */
+        if (status == TX_NO_EVENTS)
+        {
+            for (i = 0; i < server_ptr -> nx_telnet_server_max_clients; i++)
+            {
+                state =  server_ptr -> nx_telnet_server_client_list[i].nx_telnet_client_request_state;
+                if (state == NX_TELNET_CLIENT_ACCEPTING)
+                    _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_connect_pending, i);
+                else if (state > NX_TELNET_CLIENT_CONNECTED)
+                    _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_disconnect_pending, i);
+            }
+            status =  TX_SUCCESS;
+            events =  NX_TELNET_SERVER_CONNECT | NX_TELNET_SERVER_DISCONNECT;
+        }
 
         /* Check the return status.  */
         if (status)
@@ -1385,8 +1579,9 @@ ULONG                   events;
 /*                                                                        */
 /*  DESCRIPTION                                                           */ 
 /*                                                                        */ 
-/*    This function handles all TELNET client connections received.       */ 
-/*                                                                        */ 
+/*    This function handles all TELNET client connections received. It   */ 
+/*    never waits for a handshake: a new connection is accepted and       */ 
+/*    reported later, when its socket signals the completed handshake.    */ 
 /*                                                                        */ 
 /*  INPUT                                                                 */ 
 /*                                                                        */ 
@@ -1401,6 +1596,10 @@ ULONG                   events;
 /*    nx_tcp_server_socket_accept           Accept connection on socket   */ 
 /*    nx_tcp_server_socket_relisten         Relisten for connection       */ 
 /*    nx_tcp_server_socket_unaccept         Unaccept connection           */ 
+/*    _nx_telnet_server_rate_admit          Check the connection rate     */ 
+/*    _nx_telnet_server_timer_schedule      Arm the activity timer        */ 
+/*    _nx_telnet_server_connection_established                            */ 
+/*                                          Start a connection            */ 
 /*                                                                        */ 
 /*  CALLED BY                                                             */ 
 /*                                                                        */ 
@@ -1419,21 +1618,57 @@ VOID  _nx_telnet_server_connect_process(NX_TELNET_SERVER *server_ptr)
 {
 
 UINT                        i;
+UINT                        word;
+ULONG                       pending;
 UINT                        status;
 NX_TELNET_CLIENT_REQUEST    *client_req_ptr;
+NX_TELNET_SERVER_LISTENER   *listener_ptr;
 
 
     /* One of the client request sockets is in the process of connection.  */
 
-    /* Search the connections to see which one.  */
-    for (i = 0; i < NX_TELNET_MAX_CLIENTS; i++)
+    /* Look only at the sockets, that have signalled a connection.  */
+    word =  0;
+    pending =  0;
+    while (_nx_telnet_server_pending_next(server_ptr -> nx_telnet_server_connect_pending, &word, &pending, &i))
     {
 
         /* Setup pointer to client request structure.  */
         client_req_ptr =  &(server_ptr -> nx_telnet_server_client_list[i]);
 
+        /* The listening socket of the port is taken, so the port needs a new one.  */
+        listener_ptr =  &(server_ptr -> nx_telnet_server_listeners[client_req_ptr -> nx_telnet_client_request_listener]);
+        if (listener_ptr -> nx_telnet_listener_socket_ptr == &(client_req_ptr -> nx_telnet_client_request_socket))
+            listener_ptr -> nx_telnet_listener_socket_ptr =  NX_NULL;
+
+        /* A socket, that completed its handshake, is reported to the application.  */
+        if (client_req_ptr -> nx_telnet_client_request_state == NX_TELNET_CLIENT_ACCEPTING)
+        {
+
+            if (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state == NX_TCP_ESTABLISHED)
+            {
+                client_req_ptr -> nx_telnet_client_request_state =  NX_TELNET_CLIENT_CONNECTED;
+                server_ptr -> nx_telnet_server_accepting--;
+                _nx_telnet_server_connection_established(server_ptr, client_req_ptr);
+            }
+            else if (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state != NX_TCP_SYN_RECEIVED)
+            {
+
+                /* The handshake failed, take the socket back.  */
+                client_req_ptr -> nx_telnet_client_request_state =  NX_TELNET_CLIENT_CLOSED;
+                client_req_ptr -> nx_telnet_client_request_activity_timeout =  0;
+                server_ptr -> nx_telnet_server_accepting--;
+                nx_tcp_server_socket_unaccept(&(client_req_ptr -> nx_telnet_client_request_socket));
+                _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_closed, i);
+            }
+
+            /* Otherwise the handshake is still in progress.  */
+            continue;
+        }
+
         /* Now see if this socket was the one that is in being connected.  */
-        if ((client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state > NX_TCP_CLOSED) &&
+        if ((client_req_ptr -> nx_telnet_client_request_state == NX_TELNET_CLIENT_CLOSED) &&
+            (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state > NX_TCP_CLOSED) &&
             (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state < NX_TCP_ESTABLISHED) &&
             (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_connect_port))
         {
@@ -1443,75 +1678,119 @@ NX_TELNET_CLIENT_REQUEST    *client_req_ptr;
             /* Increment the number of connection requests.  */
             server_ptr -> nx_telnet_server_connection_requests++;
 
-            /* Attempt to accept on this socket.  */
-            status = nx_tcp_server_socket_accept(&(client_req_ptr -> nx_telnet_client_request_socket), NX_TELNET_SERVER_TIMEOUT);
+            /* Drop a connection over the rate limit without any reply, before it costs more work.  */
+            if (!_nx_telnet_server_rate_admit(server_ptr, &(client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_connect_ip)))
+            {
+                nx_tcp_server_socket_unaccept(&(client_req_ptr -> nx_telnet_client_request_socket));
+                _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_closed, i);
+                continue;
+            }
+
+            /* Send the SYN+ACK without waiting for the handshake, which would stall all other sessions.
+               The socket signals again, when the client has completed the handshake.  */
+            status = nx_tcp_server_socket_accept(&(client_req_ptr -> nx_telnet_client_request_socket), NX_NO_WAIT);
 
-            /* Determine if it is successful.  */
-            if (status)
+            /* Determine if the handshake is in progress.  */
+            if (status == NX_IN_PROGRESS)
             {
 
-                /* Not successful, simply unaccept on this socket.  */
-                nx_tcp_server_socket_unaccept(&(client_req_ptr -> nx_telnet_client_request_socket));
+                /* Take the socket back, if the client does not complete the handshake in time.  */
+                client_req_ptr -> nx_telnet_client_request_state =  NX_TELNET_CLIENT_ACCEPTING;
+                client_req_ptr -> nx_telnet_client_request_activity_timeout =  NX_TELNET_SERVER_ACCEPT_TIMEOUT;
+                client_req_ptr -> nx_telnet_client_request_deadline =  tx_time_get() + NX_TELNET_SERVER_ACCEPT_TIMEOUT;
+                server_ptr -> nx_telnet_server_accepting++;
+                _nx_telnet_server_timer_schedule(server_ptr);
+            }
+            else if (status == NX_SUCCESS)
+            {
+
+                /* The connection is established already.  */
+                client_req_ptr -> nx_telnet_client_request_state =  NX_TELNET_CLIENT_CONNECTED;
+                _nx_telnet_server_connection_established(server_ptr, client_req_ptr);
             }
             else
             {
 
-                /* Reset the client request activity timeout.  */
-                client_req_ptr -> nx_telnet_client_request_activity_timeout =  NX_TELNET_ACTIVITY_TIMEOUT;
+                /* Not successful, simply unaccept on this socket.  */
+                nx_tcp_server_socket_unaccept(&(client_req_ptr -> nx_telnet_client_request_socket));
+                _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_closed, i);
+            }
+        }
+    }
 
-                /* Update number of current open connections.  */
-                server_ptr -> nx_telnet_server_open_connections++;
+    /* Relisten on a closed socket.  */
+    _nx_telnet_server_relisten(server_ptr);
+}
 
-                /* Call the application's new connection callback routine.  */
-                if (server_ptr -> nx_telnet_new_connection)
-                {
-                    /* Yes, there is a new connection callback routine - call it!  */
-                    (server_ptr -> nx_telnet_new_connection)(server_ptr, client_req_ptr -> nx_telnet_client_request_connection);
-                }
 
-                /* Disable remote echo by default. */
-                if(server_ptr -> nx_telnet_set_echo)
-                    server_ptr -> nx_telnet_set_echo(server_ptr, client_req_ptr -> nx_telnet_client_request_connection, NX_FALSE);
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_connection_established            PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function starts a client connection, that has completed the   */ 
+/*    TCP handshake. It arms the activity timeout, reports the connection */ 
+/*    to the application and sends the option requests.                   */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    client_req_ptr                        Pointer to client request     */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_timer_schedule      Arm activity timer            */ 
+/*    _nx_telnet_server_send_option_requests                              */ 
+/*                                          Send option requests          */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_connect_process     Connection processing         */ 
+/*                                                                        */ 
+/**************************************************************************/
+VOID  _nx_telnet_server_connection_established(NX_TELNET_SERVER *server_ptr, NX_TELNET_CLIENT_REQUEST *client_req_ptr)
+{
 
-#ifndef NX_TELNET_SERVER_OPTION_DISABLE
+    client_req_ptr -> nx_telnet_client_request_close_requested =  NX_FALSE;
+    client_req_ptr -> nx_telnet_client_request_close_abort =  NX_FALSE;
 
-                /* Yes, send out server echo option requests. */
-                status = _nx_telnet_server_send_option_requests(server_ptr, client_req_ptr);
-                if(status != NX_SUCCESS)
-                    return;
-#endif /* NX_TELNET_SERVER_OPTION_DISABLE */
+    /* Start the client request activity timeout and arm the timer, if it expires first.  */
+    client_req_ptr -> nx_telnet_client_request_activity_timeout =  server_ptr -> nx_telnet_server_activity_timeout;
+    client_req_ptr -> nx_telnet_client_request_deadline =  tx_time_get() + client_req_ptr -> nx_telnet_client_request_activity_timeout;
+    _nx_telnet_server_timer_schedule(server_ptr);
 
-            }
-        }
-    }
+    /* Update number of current open connections.  */
+    server_ptr -> nx_telnet_server_open_connections++;
 
-    /* Now look for a socket that is closed to relisten on.  */
-    for (i = 0; i < NX_TELNET_MAX_CLIENTS; i++)
+    /* Call the application's new connection callback routine.  */
+    if (server_ptr -> nx_telnet_new_connection)
     {
+        /* Yes, there is a new connection callback routine - call it!  */
+        (server_ptr -> nx_telnet_new_connection)(server_ptr, client_req_ptr -> nx_telnet_client_request_connection);
+    }
 
-        /* Set a pointer to client request structure.  */
-        client_req_ptr =  &(server_ptr -> nx_telnet_server_client_list[i]);
+    /* The application may have rejected the connection already.  */
+    if (client_req_ptr -> nx_telnet_client_request_close_requested)
+        return;
 
-        /* Now see if this socket is closed.  */
-        if (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state == NX_TCP_CLOSED)
-        {
+    /* Disable remote echo by default. */
+    if(server_ptr -> nx_telnet_set_echo)
+        server_ptr -> nx_telnet_set_echo(server_ptr, client_req_ptr -> nx_telnet_client_request_connection, NX_FALSE);
 
-            /* Relisten on this socket.  */
-            status =  nx_tcp_server_socket_relisten(server_ptr -> nx_telnet_server_ip_ptr, NX_TELNET_SERVER_PORT, 
-                                                    &(client_req_ptr -> nx_telnet_client_request_socket));
-            /* Check for bad status.  */
-            if ((status != NX_SUCCESS) && (status != NX_CONNECTION_PENDING))
-            {
+#ifndef NX_TELNET_SERVER_OPTION_DISABLE
 
-                /* Increment the error count and keep trying.  */
-                server_ptr -> nx_telnet_server_relisten_errors++;
-                continue;
-            }
-            
-            /* Break out of loop.  */
-            break;
-        }
-    }
+    /* Yes, send out server echo option requests, unless the application negotiates itself.  A failed
+       request leaves the connection to the application.  */
+    if (!server_ptr -> nx_telnet_server_option_requests_disable)
+        _nx_telnet_server_send_option_requests(server_ptr, client_req_ptr);
+#endif /* NX_TELNET_SERVER_OPTION_DISABLE */
 }
 
 
@@ -1567,7 +1846,8 @@ NX_TELNET_SERVER   *server_ptr;
     /* Pickup server pointer.  This is setup in the reserved field of the TCP socket.  */
     server_ptr =  socket_ptr -> nx_tcp_socket_reserved_ptr;
 
-    /* Set the connect event flag.  */
+    /* Mark this socket and set the connect event flag.  */
+    _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_connect_pending, _nx_telnet_server_socket_index(server_ptr, socket_ptr));
     tx_event_flags_set(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_SERVER_CONNECT, TX_OR);
 }
 
@@ -1576,17 +1856,12 @@ NX_TELNET_SERVER   *server_ptr;
 /*                                                                        */ 
 /*  FUNCTION                                               RELEASE        */ 
 /*                                                                        */ 
-/*    _nx_telnet_server_disconnect_present                PORTABLE C      */ 
-/*                                                           6.1          */
-/*  AUTHOR                                                                */
-/*                                                                        */
-/*    Yuxin Zhou, Microsoft Corporation                                   */
-/*                                                                        */
-/*  DESCRIPTION                                                           */ 
+/*    _nx_telnet_server_establish_present                 PORTABLE C      */ 
 /*                                                                        */ 
-/*    This function handles all TELNET client disconnections received on  */ 
-/*    the socket.                                                         */ 
+/*  DESCRIPTION                                                           */ 
 /*                                                                        */ 
+/*    This function signals the server thread, that a client has         */ 
+/*    completed the TCP handshake of an accepted socket.                  */ 
 /*                                                                        */ 
 /*  INPUT                                                                 */ 
 /*                                                                        */ 
@@ -1602,14 +1877,62 @@ NX_TELNET_SERVER   *server_ptr;
 /*                                                                        */ 
 /*  CALLED BY                                                             */ 
 /*                                                                        */ 
-/*    NetX                                  NetX connect callback         */ 
-/*                                                                        */ 
-/*  RELEASE HISTORY                                                       */ 
+/*    NetX                                  NetX establish callback       */ 
 /*                                                                        */ 
-/*    DATE              NAME                      DESCRIPTION             */
-/*                                                                        */
-/*  05-19-2020     Yuxin Zhou               Initial Version 6.0           */
-/*  09-30-2020     Yuxin Zhou               Modified comment(s),          */
+/**************************************************************************/
+VOID  _nx_telnet_server_establish_present(NX_TCP_SOCKET *socket_ptr)
+{
+
+NX_TELNET_SERVER   *server_ptr;
+
+
+    /* Pickup server pointer.  This is setup in the reserved field of the TCP socket.  */
+    server_ptr =  socket_ptr -> nx_tcp_socket_reserved_ptr;
+
+    /* Mark this socket and set the connect event flag.  */
+    _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_connect_pending, _nx_telnet_server_socket_index(server_ptr, socket_ptr));
+    tx_event_flags_set(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_SERVER_CONNECT, TX_OR);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_disconnect_present                PORTABLE C      */ 
+/*                                                           6.1          */
+/*  AUTHOR                                                                */
+/*                                                                        */
+/*    Yuxin Zhou, Microsoft Corporation                                   */
+/*                                                                        */
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function handles all TELNET client disconnections received on  */ 
+/*    the socket.                                                         */ 
+/*                                                                        */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    socket_ptr                            Socket event occurred         */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    tx_event_flags_set                    Set events for server thread  */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    NetX                                  NetX connect callback         */ 
+/*                                                                        */ 
+/*  RELEASE HISTORY                                                       */ 
+/*                                                                        */ 
+/*    DATE              NAME                      DESCRIPTION             */
+/*                                                                        */
+/*  05-19-2020     Yuxin Zhou               Initial Version 6.0           */
+/*  09-30-2020     Yuxin Zhou               Modified comment(s),          */
 /*                                            resulting in version 6.1    */
 /*                                                                        */
 /**************************************************************************/
@@ -1621,7 +1944,8 @@ NX_TELNET_SERVER   *server_ptr;
     /* Pickup server pointer.  This is setup in the reserved field of the TCP socket.  */
     server_ptr =  socket_ptr -> nx_tcp_socket_reserved_ptr;
 
-    /* Set the disconnect event flag.  */
+    /* Mark this socket and set the disconnect event flag.  */
+    _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_disconnect_pending, _nx_telnet_server_socket_index(server_ptr, socket_ptr));
     tx_event_flags_set(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_SERVER_DISCONNECT, TX_OR);
 }
 
@@ -1639,8 +1963,8 @@ NX_TELNET_SERVER   *server_ptr;
 /*  DESCRIPTION                                                           */ 
 /*                                                                        */ 
 /*    This function processes all TELNET client disconnections received   */ 
-/*    on the socket.                                                      */ 
-/*                                                                        */ 
+/*    on the socket. It never waits for a close: each step is taken,      */ 
+/*    when the socket signals again.                                      */ 
 /*                                                                        */ 
 /*  INPUT                                                                 */ 
 /*                                                                        */ 
@@ -1654,7 +1978,8 @@ NX_TELNET_SERVER   *server_ptr;
 /*                                                                        */ 
 /*    nx_tcp_server_socket_relisten         Relisten on Telnet port       */ 
 /*    nx_tcp_server_socket_unaccept         Unaccept connection           */ 
-/*    nx_tcp_socket_disconnect              Disconnect socket             */ 
+/*    _nx_telnet_server_close_start         Start a close                 */ 
+/*    _nx_telnet_server_close_continue      Go on with a close            */ 
 /*                                                                        */ 
 /*  CALLED BY                                                             */ 
 /*                                                                        */ 
@@ -1673,97 +1998,294 @@ VOID  _nx_telnet_server_disconnect_process(NX_TELNET_SERVER *server_ptr)
 {
 
 UINT                        i;
-UINT                        status;
+UINT                        word;
+ULONG                       pending;
 NX_TELNET_CLIENT_REQUEST   *client_req_ptr;
-UINT                        reset_client_request;
 
 
-    /* Now look for a socket that has a disconnect state.  */
-    for (i = 0; i < NX_TELNET_MAX_CLIENTS; i++)
+    /* Now look at the sockets, that have signalled a disconnect.  */
+    word =  0;
+    pending =  0;
+    while (_nx_telnet_server_pending_next(server_ptr -> nx_telnet_server_disconnect_pending, &word, &pending, &i))
     {
 
-        reset_client_request = NX_FALSE;
-
         /* Setup pointer to client request structure.  */
         client_req_ptr =  &(server_ptr -> nx_telnet_server_client_list[i]);
 
-       /* Has the socket received a RST packet? If so NetX will put it in a CLOSED or LISTEN state
-          and the socket activity timeout has not been reset yet.  */
-       if (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state < NX_TCP_SYN_SENT)            
-       { 
+        /* Has a handshake been reset? If so NetX will put the socket in a CLOSED or LISTEN state.  A client, that
+           has not completed the handshake, was never reported to the application.  */
+        if (client_req_ptr -> nx_telnet_client_request_state == NX_TELNET_CLIENT_ACCEPTING)
+        {
 
-            if (client_req_ptr -> nx_telnet_client_request_activity_timeout > 0)        
+            if (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state < NX_TCP_SYN_SENT)
             {
-
-                reset_client_request = NX_TRUE;
+                client_req_ptr -> nx_telnet_client_request_state =  NX_TELNET_CLIENT_CLOSED;
+                client_req_ptr -> nx_telnet_client_request_activity_timeout =  0;
+                server_ptr -> nx_telnet_server_accepting--;
+                nx_tcp_server_socket_unaccept(&(client_req_ptr -> nx_telnet_client_request_socket));
+                _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_closed, i);
             }
-       } 
-       else
-       {
-       
-            /* Now see if this socket has entered a disconnect state.  */
-            while (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state > NX_TCP_ESTABLISHED) 
-            {
-    
-                /* Yes, a disconnect is present, which signals an end of session for TELNET request.  */
-    
-                /* First, cleanup this socket.  */
-                nx_tcp_socket_disconnect(&(client_req_ptr -> nx_telnet_client_request_socket), NX_TELNET_SERVER_TIMEOUT);    
+        }
+
+        /* Start to close a connection, that the client has closed or reset, or the application wants to close.  */
+        else if (client_req_ptr -> nx_telnet_client_request_state == NX_TELNET_CLIENT_CONNECTED)
+        {
 
-                reset_client_request = NX_TRUE;
+            if ((client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state != NX_TCP_ESTABLISHED) ||
+                (client_req_ptr -> nx_telnet_client_request_close_requested))
+            {
+                _nx_telnet_server_close_start(server_ptr, client_req_ptr);
             }
-       }
+        }
 
-       /* If this connection is closed, update the telnet data and notify the application of a disconnect. */
-       if (reset_client_request == NX_TRUE)
-       {
+        /* Go on with a close in progress.  */
+        else if (client_req_ptr -> nx_telnet_client_request_state != NX_TELNET_CLIENT_CLOSED)
+        {
+            _nx_telnet_server_close_continue(server_ptr, client_req_ptr);
+        }
+    }
 
-           /* Unaccept this socket.  */
-           nx_tcp_server_socket_unaccept(&(client_req_ptr -> nx_telnet_client_request_socket));
+    /* Relisten on a closed socket.  */
+    _nx_telnet_server_relisten(server_ptr);
+}
 
-           /* Reset the client request activity timeout.  */
-           client_req_ptr -> nx_telnet_client_request_activity_timeout =  0;
 
-           /* Update number of current open connections. */
-           if (server_ptr -> nx_telnet_server_open_connections > 0)
-               server_ptr -> nx_telnet_server_open_connections--;
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_close_start                       PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function starts to close a client connection without waiting  */ 
+/*    for it. Unless the close policy is abortive, the connection gets    */ 
+/*    the close timeout of the server to deliver its output and finish    */ 
+/*    the FIN exchange.                                                   */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    client_req_ptr                        Pointer to client request     */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_close_abort         Abort the close               */ 
+/*    _nx_telnet_server_close_continue      Go on with the close          */ 
+/*    _nx_telnet_server_timer_schedule      Arm the activity timer        */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_disconnect_process  Disconnect processing         */ 
+/*    _nx_telnet_server_timeout_processing  Activity timeout processing   */ 
+/*                                                                        */ 
+/**************************************************************************/
+VOID  _nx_telnet_server_close_start(NX_TELNET_SERVER *server_ptr, NX_TELNET_CLIENT_REQUEST *client_req_ptr)
+{
 
-           /* Call the application's end connection callback routine.  */
-           if (server_ptr -> nx_telnet_connection_end)
-           {
+    /* Increment the number of disconnection requests.  */
+    server_ptr -> nx_telnet_server_disconnection_requests++;
 
-               /* Yes, there is a connection end callback routine - call it!  */
-               (server_ptr -> nx_telnet_connection_end)(server_ptr, client_req_ptr -> nx_telnet_client_request_connection);
-           }
-       }
-    }
+    client_req_ptr -> nx_telnet_client_request_state =  NX_TELNET_CLIENT_DRAINING;
+    server_ptr -> nx_telnet_server_closing++;
 
-    /* Now look for a socket that is closed to relisten on.  */
-    for (i = 0; i < NX_TELNET_MAX_CLIENTS; i++)
+    /* An abortive close takes the socket back at once.  */
+    if ((server_ptr -> nx_telnet_server_close_policy == NX_TELNET_CLOSE_ABORTIVE) ||
+        (client_req_ptr -> nx_telnet_client_request_close_abort))
     {
+        _nx_telnet_server_close_abort(server_ptr, client_req_ptr);
+        return;
+    }
 
-        /* Setup pointer to client request structure.  */
-        client_req_ptr =  &(server_ptr -> nx_telnet_server_client_list[i]);
+    /* The output is delivered first, the deadline takes the socket back in any case.  */
+    client_req_ptr -> nx_telnet_client_request_activity_timeout =  server_ptr -> nx_telnet_server_close_timeout;
+    client_req_ptr -> nx_telnet_client_request_deadline =  tx_time_get() + server_ptr -> nx_telnet_server_close_timeout;
+    _nx_telnet_server_timer_schedule(server_ptr);
 
-        /* Now see if this socket is closed.  */
-        if (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state == NX_TCP_CLOSED)
-        {
+    _nx_telnet_server_close_continue(server_ptr, client_req_ptr);
+}
 
-            /* Relisten on this socket.  */
-            status =  nx_tcp_server_socket_relisten(server_ptr -> nx_telnet_server_ip_ptr, NX_TELNET_SERVER_PORT, 
-                                                    &(client_req_ptr -> nx_telnet_client_request_socket));
-            /* Check for bad status.  */
-            if ((status != NX_SUCCESS) && (status != NX_CONNECTION_PENDING))
-            {
 
-                /* Increment the error count and keep trying.  */
-                server_ptr -> nx_telnet_server_relisten_errors++;
-                continue;
-            }
-            
-            /* Break out of loop.  */
-            break;
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_close_continue                    PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function takes a closing client connection one step further.   */ 
+/*    The FIN is sent, when the client has acknowledged all output, as    */ 
+/*    NetX drops the unacknowledged output on disconnect. The socket is   */ 
+/*    taken back, when NetX has finished the FIN exchange.                */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    client_req_ptr                        Pointer to client request     */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    nx_tcp_socket_disconnect              Disconnect socket             */ 
+/*    _nx_telnet_server_close_finish        Finish the close              */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_close_start         Start a close                 */ 
+/*    _nx_telnet_server_disconnect_process  Disconnect processing         */ 
+/*                                                                        */ 
+/**************************************************************************/
+VOID  _nx_telnet_server_close_continue(NX_TELNET_SERVER *server_ptr, NX_TELNET_CLIENT_REQUEST *client_req_ptr)
+{
+
+NX_TCP_SOCKET   *socket_ptr;
+
+
+    socket_ptr =  &(client_req_ptr -> nx_telnet_client_request_socket);
+
+    if (client_req_ptr -> nx_telnet_client_request_state == NX_TELNET_CLIENT_DRAINING)
+    {
+
+        /* A socket, that can still send, waits for the client to acknowledge the output.  */
+        if ((socket_ptr -> nx_tcp_socket_state == NX_TCP_ESTABLISHED) || (socket_ptr -> nx_tcp_socket_state == NX_TCP_CLOSE_WAIT))
+        {
+            if (socket_ptr -> nx_tcp_socket_transmit_sent_count)
+                return;
+
+            /* Send the FIN without waiting.  Unless NX_DISABLE_RESET_DISCONNECT is defined, NetX sends a RST
+               instead and the socket is closed right away.  */
+            nx_tcp_socket_disconnect(socket_ptr, NX_NO_WAIT);
         }
+
+        client_req_ptr -> nx_telnet_client_request_state =  NX_TELNET_CLIENT_CLOSING;
+    }
+
+    /* Wait for NetX to finish the FIN exchange.  */
+    if ((socket_ptr -> nx_tcp_socket_state > NX_TCP_LISTEN_STATE) && (socket_ptr -> nx_tcp_socket_state != NX_TCP_TIMED_WAIT))
+        return;
+
+    _nx_telnet_server_close_finish(server_ptr, client_req_ptr);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_close_abort                       PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function takes the socket of a closing client connection back */ 
+/*    at once, so it can relisten. The output, that is not acknowledged  */ 
+/*    yet, is dropped. A socket, that can still send, sends its FIN now,  */ 
+/*    or a RST unless NX_DISABLE_RESET_DISCONNECT is defined. NetX        */ 
+/*    answers the late segments of the client with a RST, as soon as the */ 
+/*    socket is unaccepted.                                               */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    client_req_ptr                        Pointer to client request     */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    nx_tcp_socket_disconnect              Disconnect socket             */ 
+/*    _nx_telnet_server_close_finish        Finish the close              */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_close_start         Start a close                 */ 
+/*    _nx_telnet_server_timeout_processing  Activity timeout processing   */ 
+/*                                                                        */ 
+/**************************************************************************/
+VOID  _nx_telnet_server_close_abort(NX_TELNET_SERVER *server_ptr, NX_TELNET_CLIENT_REQUEST *client_req_ptr)
+{
+
+NX_TCP_SOCKET   *socket_ptr;
+
+
+    socket_ptr =  &(client_req_ptr -> nx_telnet_client_request_socket);
+
+    /* Count a connection, that is not closed yet.  */
+    if ((socket_ptr -> nx_tcp_socket_state > NX_TCP_LISTEN_STATE) && (socket_ptr -> nx_tcp_socket_state != NX_TCP_TIMED_WAIT))
+        server_ptr -> nx_telnet_server_close_aborts++;
+
+    /* Send the FIN or RST of a socket, that has not sent it yet.  */
+    if ((socket_ptr -> nx_tcp_socket_state == NX_TCP_ESTABLISHED) || (socket_ptr -> nx_tcp_socket_state == NX_TCP_CLOSE_WAIT))
+        nx_tcp_socket_disconnect(socket_ptr, NX_NO_WAIT);
+
+    _nx_telnet_server_close_finish(server_ptr, client_req_ptr);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_close_finish                      PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function takes the socket of a closed client connection back   */ 
+/*    for a relisten and reports the end of the connection to the         */ 
+/*    application.                                                        */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    client_req_ptr                        Pointer to client request     */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    nx_tcp_server_socket_unaccept         Unaccept connection           */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_close_continue      Go on with a close            */ 
+/*    _nx_telnet_server_close_abort         Abort a close                 */ 
+/*                                                                        */ 
+/**************************************************************************/
+VOID  _nx_telnet_server_close_finish(NX_TELNET_SERVER *server_ptr, NX_TELNET_CLIENT_REQUEST *client_req_ptr)
+{
+
+    /* Unaccept this socket, which gives up a FIN exchange, that has not finished.  */
+    nx_tcp_server_socket_unaccept(&(client_req_ptr -> nx_telnet_client_request_socket));
+    _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_closed, client_req_ptr -> nx_telnet_client_request_connection);
+
+    /* Reset the client request.  */
+    client_req_ptr -> nx_telnet_client_request_state =  NX_TELNET_CLIENT_CLOSED;
+    client_req_ptr -> nx_telnet_client_request_close_requested =  NX_FALSE;
+    client_req_ptr -> nx_telnet_client_request_close_abort =  NX_FALSE;
+    client_req_ptr -> nx_telnet_client_request_activity_timeout =  0;
+    server_ptr -> nx_telnet_server_closing--;
+
+    /* Update number of current open connections. */
+    if (server_ptr -> nx_telnet_server_open_connections > 0)
+        server_ptr -> nx_telnet_server_open_connections--;
+
+    /* Call the application's end connection callback routine.  */
+    if (server_ptr -> nx_telnet_connection_end)
+    {
+
+        /* Yes, there is a connection end callback routine - call it!  */
+        (server_ptr -> nx_telnet_connection_end)(server_ptr, client_req_ptr -> nx_telnet_client_request_connection);
     }
 }
 
@@ -1817,7 +2339,8 @@ NX_TELNET_SERVER   *server_ptr;
     /* Pickup server pointer.  This is setup in the reserved field of the TCP socket.  */
     server_ptr =  socket_ptr -> nx_tcp_socket_reserved_ptr;
 
-    /* Set the data event flag.  */
+    /* Mark this socket and set the data event flag.  */
+    _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_data_pending, _nx_telnet_server_socket_index(server_ptr, socket_ptr));
     tx_event_flags_set(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_SERVER_DATA, TX_OR);
 }
 
@@ -1868,6 +2391,8 @@ VOID  _nx_telnet_server_data_process(NX_TELNET_SERVER *server_ptr)
 {
 
 UINT                        i;
+UINT                        word;
+ULONG                       pending;
 UINT                        status;
 NX_PACKET                   *packet_ptr;
 NX_TELNET_CLIENT_REQUEST    *client_req_ptr;
@@ -1876,19 +2401,43 @@ UCHAR                       data_char;
 UINT                        offset;
 #endif /* NX_TELNET_SERVER_OPTION_DISABLE */
 
-    /* Now look for a socket that has receive data.  */
-    for (i = 0; i < NX_TELNET_MAX_CLIENTS; i++)
+    /* Now look at the sockets, that have signalled receive data.  */
+    word =  0;
+    pending =  0;
+    while (_nx_telnet_server_pending_next(server_ptr -> nx_telnet_server_data_pending, &word, &pending, &i))
     {
 
         /* Setup pointer to client request structure.  */
         client_req_ptr =  &(server_ptr -> nx_telnet_server_client_list[i]);
 
+        /* Data completes the handshake of an accepted socket, which has to be reported first.  */
+        if (client_req_ptr -> nx_telnet_client_request_state == NX_TELNET_CLIENT_ACCEPTING)
+        {
+            _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_connect_pending, i);
+            _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_data_pending, i);
+            tx_event_flags_set(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_SERVER_CONNECT | NX_TELNET_SERVER_DATA, TX_OR);
+            continue;
+        }
+
+        /* Data of a connection, that is closing, is dropped with the socket.  */
+        if (client_req_ptr -> nx_telnet_client_request_state != NX_TELNET_CLIENT_CONNECTED)
+            continue;
+
         /* Now see if this socket has data.  If so, process all of it now!  */
         while (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_receive_queue_count)
         {
 
-            /* Reset the client request activity timeout.  */
-            client_req_ptr -> nx_telnet_client_request_activity_timeout =  NX_TELNET_ACTIVITY_TIMEOUT;
+            /* Move the deadline of the client request.  The timer is left alone, as the deadline only
+               gets later; an expiry in between finds the new deadline and re-arms.  */
+            client_req_ptr -> nx_telnet_client_request_deadline =  tx_time_get() + client_req_ptr -> nx_telnet_client_request_activity_timeout;
+
+            /* Leave the data on the socket while the application is busy, which closes the receive window.  */
+            if (client_req_ptr -> nx_telnet_client_request_receive_paused)
+            {
+
+                /* Break to look at the next socket.  */
+                break;
+            }
 
             /* Attempt to read a packet from this socket.  */
             status =  nx_tcp_socket_receive(&(client_req_ptr -> nx_telnet_client_request_socket), &packet_ptr, NX_NO_WAIT);
@@ -1904,8 +2453,8 @@ UINT                        offset;
 #ifndef NX_TELNET_SERVER_OPTION_DISABLE
 
             /* If the first byte of the packet data is the telnet "IAC" code, 
-            this is a telnet option packet.  */
-            if (*packet_ptr -> nx_packet_prepend_ptr == NX_TELNET_IAC)
+            this is a telnet option packet, unless the application parses telnet commands itself.  */
+            if ((!server_ptr -> nx_telnet_server_raw_receive) && (*packet_ptr -> nx_packet_prepend_ptr == NX_TELNET_IAC))
             {
 
 #ifndef NX_DISABLE_PACKET_CHAIN
@@ -1989,36 +2538,1018 @@ UINT                        offset;
                 else
                 {
 
-                    /* Error, no application callback routine.  */
+                    /* Error, no application callback routine.  */
+
+                    /* Release the packet and continue the loop.  */
+                    nx_packet_release(packet_ptr);
+                }
+            }
+#else
+           if ((!server_ptr -> nx_telnet_server_raw_receive) && (*packet_ptr -> nx_packet_prepend_ptr == NX_TELNET_IAC))
+           {
+                nx_packet_release(packet_ptr);
+           }
+           /* Call the server receive callback.  */
+           else if (server_ptr -> nx_telnet_receive_data)
+           {
+
+               /* Yes, there is a process data callback routine - call it!  */
+               (server_ptr -> nx_telnet_receive_data)(server_ptr, client_req_ptr -> nx_telnet_client_request_connection, packet_ptr);
+           }
+           else
+           {
+
+               /* Error, no application callback routine.  */
+
+               /* Release the packet and continue the loop.  */
+               nx_packet_release(packet_ptr);
+           }
+
+#endif /* NX_TELNET_SERVER_OPTION_DISABLE */
+        }
+    }
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_timeout                           PORTABLE C      */ 
+/*                                                           6.1          */
+/*  AUTHOR                                                                */
+/*                                                                        */
+/*    Yuxin Zhou, Microsoft Corporation                                   */
+/*                                                                        */
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function is the periodic timer for this TELNET server. Its     */ 
+/*    duty is to inform the TELNET server that it is time to check for    */
+/*    activity timeouts.                                                  */ 
+/*                                                                        */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    telnet_server_address                 TELNET server's address       */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    tx_event_flags_set                    Set events for server thread  */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    ThreadX                               ThreadX timer callback        */ 
+/*                                                                        */ 
+/*  RELEASE HISTORY                                                       */ 
+/*                                                                        */ 
+/*    DATE              NAME                      DESCRIPTION             */
+/*                                                                        */
+/*  05-19-2020     Yuxin Zhou               Initial Version 6.0           */
+/*  09-30-2020     Yuxin Zhou               Modified comment(s),          */
+/*                                            resulting in version 6.1    */
+/*                                                                        */
+/**************************************************************************/
+VOID  _nx_telnet_server_timeout(ULONG telnet_server_address)
+{
+
+NX_TELNET_SERVER   *server_ptr;
+
+    /* Pickup server pointer.  */
+    server_ptr =  (NX_TELNET_SERVER *) telnet_server_address;
+
+    /* Set the data event flag.  */
+    tx_event_flags_set(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_SERVER_ACTIVITY_TIMEOUT, TX_OR);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_timeout_processing                PORTABLE C      */ 
+/*                                                           6.1          */
+/*  AUTHOR                                                                */
+/*                                                                        */
+/*    Yuxin Zhou, Microsoft Corporation                                   */
+/*                                                                        */
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function is called when the activity timer expires. Every      */ 
+/*    idle connection, whose deadline has passed, is closed; handshakes   */ 
+/*    and closes, that have not finished in time, are given up and their  */ 
+/*    sockets made available to a new connection. The timer is then       */ 
+/*    re-armed for the nearest deadline of the remaining connections.     */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    nx_tcp_server_socket_relisten         Relisten for another connect  */ 
+/*    nx_tcp_server_socket_unaccept         Unaccept server connection    */ 
+/*    nx_tcp_socket_disconnect              Disconnect socket             */ 
+/*    _nx_telnet_server_close_start         Start a close                 */ 
+/*    _nx_telnet_server_close_abort         Abort a close                 */ 
+/*    _nx_telnet_server_timer_schedule      Re-arm the activity timer     */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_thread_entry        TELNET server thread          */ 
+/*                                                                        */ 
+/*  RELEASE HISTORY                                                       */ 
+/*                                                                        */ 
+/*    DATE              NAME                      DESCRIPTION             */
+/*                                                                        */
+/*  05-19-2020     Yuxin Zhou               Initial Version 6.0           */
+/*  09-30-2020     Yuxin Zhou               Modified comment(s),          */
+/*                                            resulting in version 6.1    */
+/*                                                                        */
+/**************************************************************************/
+VOID  _nx_telnet_server_timeout_processing(NX_TELNET_SERVER *server_ptr)
+{
+
+UINT                        i;
+ULONG                       current_time;
+NX_TELNET_CLIENT_REQUEST   *client_req_ptr;
+
+
+    /* Pickup the current time.  */
+    current_time =  tx_time_get();
+
+    /* Now look through all the sockets.  */
+    for (i = 0; i < server_ptr -> nx_telnet_server_max_clients; i++)
+    {
+
+        /* Set a pointer to client request structure.  */
+        client_req_ptr =  &(server_ptr -> nx_telnet_server_client_list[i]);
+
+        /* Now see if this socket has an activity timeout active.  */
+        if ((client_req_ptr -> nx_telnet_client_request_activity_timeout) &&
+            (client_req_ptr -> nx_telnet_client_request_activity_timeout != NX_TELNET_NO_ACTIVITY_TIMEOUT))
+        {
+
+            /* Determine if this entry has passed its deadline, the difference handles the wrap of the time.  */
+            if ((LONG) (client_req_ptr -> nx_telnet_client_request_deadline - current_time) <= 0)
+            {
+
+                /* Yes, the deadline has passed.  */
+                client_req_ptr -> nx_telnet_client_request_activity_timeout =  0;
+
+                if (client_req_ptr -> nx_telnet_client_request_state == NX_TELNET_CLIENT_ACCEPTING)
+                {
+
+                    /* The client has not completed the handshake in time.  It was never reported to the
+                       application, so the socket is simply taken back.  */
+                    server_ptr -> nx_telnet_server_accept_timeouts++;
+                    client_req_ptr -> nx_telnet_client_request_state =  NX_TELNET_CLIENT_CLOSED;
+                    server_ptr -> nx_telnet_server_accepting--;
+                    nx_tcp_socket_disconnect(&(client_req_ptr -> nx_telnet_client_request_socket), NX_NO_WAIT);
+                    nx_tcp_server_socket_unaccept(&(client_req_ptr -> nx_telnet_client_request_socket));
+                    _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_closed, i);
+                }
+                else if (client_req_ptr -> nx_telnet_client_request_state == NX_TELNET_CLIENT_CONNECTED)
+                {
+
+                    /* The activity timeout has been exceeded, close the connection.  */
+                    server_ptr -> nx_telnet_server_activity_timeouts++;
+                    _nx_telnet_server_close_start(server_ptr, client_req_ptr);
+                }
+                else
+                {
+
+                    /* The close has not finished in time, take the socket back.  */
+                    _nx_telnet_server_close_abort(server_ptr, client_req_ptr);
+                }
+            }
+        }
+    }
+
+    /* Relisten on the closed sockets.  */
+    _nx_telnet_server_relisten(server_ptr);
+
+    /* Arm the timer for the nearest deadline left.  */
+    _nx_telnet_server_timer_schedule(server_ptr);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_socket_index                      PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function returns the index of a client request socket in the   */ 
+/*    client list of the server.                                          */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    socket_ptr                            Client request socket         */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    index                                 Index in the client list      */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_connection_present  Connection notify callback    */ 
+/*    _nx_telnet_server_disconnect_present  Disconnect notify callback    */ 
+/*    _nx_telnet_server_data_present        Receive notify callback       */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nx_telnet_server_socket_index(NX_TELNET_SERVER *server_ptr, NX_TCP_SOCKET *socket_ptr)
+{
+
+    /* The sockets are embedded in the client requests, so the distance to the first one gives the index.  */
+    return((UINT) (((UCHAR *) socket_ptr - (UCHAR *) &(server_ptr -> nx_telnet_server_client_list[0].nx_telnet_client_request_socket)) /
+                   sizeof(NX_TELNET_CLIENT_REQUEST)));
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_pending_set                       PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function sets the bit of a socket in a socket bitmap. The      */ 
+/*    bitmaps are shared with the notify callbacks of the IP thread, so   */ 
+/*    the bit is set with interrupts disabled.                            */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    bitmap                                Pointer to socket bitmap      */ 
+/*    index                                 Index in the client list      */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    TELNET server internal functions                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+VOID  _nx_telnet_server_pending_set(ULONG *bitmap, UINT index)
+{
+
+TX_INTERRUPT_SAVE_AREA
+
+
+    /* A pointer outside of the client list must not corrupt the server.  */
+    if (index >= (NX_TELNET_SERVER_BITMAP_WORDS * 32))
+        return;
+
+    TX_DISABLE
+    bitmap[index / 32] |=  ((ULONG) 1) << (index % 32);
+    TX_RESTORE
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_pending_next                      PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function returns the next socket of a socket bitmap and clears */ 
+/*    its bit. A whole word of the bitmap is taken at once, bits set      */ 
+/*    meanwhile are returned by a later call. The cost depends on the     */ 
+/*    number of sockets marked, not on the number of clients.             */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    bitmap                                Pointer to socket bitmap      */ 
+/*    word_ptr                              Next word to take, 0 at start */ 
+/*    bits_ptr                              Bits taken, 0 at start        */ 
+/*    index_ptr                             Destination for the index     */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    NX_TRUE                               A socket has been returned    */ 
+/*    NX_FALSE                              No socket is left             */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    TELNET server internal functions                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nx_telnet_server_pending_next(ULONG *bitmap, UINT *word_ptr, ULONG *bits_ptr, UINT *index_ptr)
+{
+
+TX_INTERRUPT_SAVE_AREA
+
+ULONG   bits;
+UINT    bit;
+
+
+    /* Take the next word with a socket marked.  */
+    while (*bits_ptr == 0)
+    {
+
+        if (*word_ptr >= NX_TELNET_SERVER_BITMAP_WORDS)
+            return(NX_FALSE);
+
+        TX_DISABLE
+        *bits_ptr =  bitmap[*word_ptr];
+        bitmap[*word_ptr] =  0;
+        TX_RESTORE
+
+        (*word_ptr)++;
+    }
+
+    /* Find the lowest bit, halving the search range on every step.  */
+    bits =  *bits_ptr;
+    bit =  0;
+    if ((bits & 0xFFFF) == 0) { bits >>= 16; bit += 16; }
+    if ((bits & 0xFF) == 0)   { bits >>= 8;  bit += 8; }
+    if ((bits & 0xF) == 0)    { bits >>= 4;  bit += 4; }
+    if ((bits & 0x3) == 0)    { bits >>= 2;  bit += 2; }
+    if ((bits & 0x1) == 0)    { bit += 1; }
+
+    /* Clear the bit and return the socket.  */
+    *bits_ptr &=  *bits_ptr - 1;
+    *index_ptr =  ((*word_ptr - 1) * 32) + bit;
+    return(NX_TRUE);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_relisten                          PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function relistens on a closed socket of every port, that has  */ 
+/*    no listening socket. A socket, that takes a queued connection, does */ 
+/*    not listen, so the next closed socket of its port is tried. Closed  */ 
+/*    sockets are kept in a bitmap, so connected sockets are not looked   */ 
+/*    at.                                                                 */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    nx_tcp_server_socket_relisten         Relisten for connection       */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    TELNET server internal functions                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+VOID  _nx_telnet_server_relisten(NX_TELNET_SERVER *server_ptr)
+{
+
+UINT                        i;
+UINT                        word;
+ULONG                       closed;
+UINT                        status;
+NX_TELNET_CLIENT_REQUEST   *client_req_ptr;
+NX_TELNET_SERVER_LISTENER  *listener_ptr;
+
+
+    /* Take the closed sockets, the ones not relistened on are put back.  Words are taken once,
+       so a socket put back is not looked at again in this pass.  */
+    word =  0;
+    closed =  0;
+    while (_nx_telnet_server_pending_next(server_ptr -> nx_telnet_server_closed, &word, &closed, &i))
+    {
+
+        /* Setup pointer to client request structure.  */
+        client_req_ptr =  &(server_ptr -> nx_telnet_server_client_list[i]);
+
+        /* Skip a socket, that is in use again.  */
+        if (client_req_ptr -> nx_telnet_client_request_socket.nx_tcp_socket_state != NX_TCP_CLOSED)
+            continue;
+
+        /* Keep the socket, if its port has a listening socket already.  */
+        listener_ptr =  &(server_ptr -> nx_telnet_server_listeners[client_req_ptr -> nx_telnet_client_request_listener]);
+        if (listener_ptr -> nx_telnet_listener_socket_ptr != NX_NULL)
+        {
+            _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_closed, i);
+            continue;
+        }
+
+        /* Relisten on this socket.  */
+        status =  nx_tcp_server_socket_relisten(server_ptr -> nx_telnet_server_ip_ptr, listener_ptr -> nx_telnet_listener_port, 
+                                                &(client_req_ptr -> nx_telnet_client_request_socket));
+
+        /* The socket listens now.  */
+        if (status == NX_SUCCESS)
+            listener_ptr -> nx_telnet_listener_socket_ptr =  &(client_req_ptr -> nx_telnet_client_request_socket);
+
+        /* Check for bad status, a queued connection is handled by the connect processing.  */
+        else if (status != NX_CONNECTION_PENDING)
+        {
+
+            /* Increment the error count and keep trying.  */
+            server_ptr -> nx_telnet_server_relisten_errors++;
+            _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_closed, i);
+        }
+    }
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_rate_admit                        PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function decides, if a new connection is within the rate       */ 
+/*    limits. Every client address has a token bucket, that allows a      */ 
+/*    burst of connections and regains one every refill period. The       */ 
+/*    table of buckets has a fixed size, the address seen least recently  */ 
+/*    gives way to a new one. All clients together are limited to a       */ 
+/*    number of connections per second on top.                            */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    source_ptr                            Address of the client         */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    NX_TRUE                               Connection admitted           */ 
+/*    NX_FALSE                              Connection over the limit     */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    tx_time_get                           Get the current tick          */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_connect_process     Connection processing         */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nx_telnet_server_rate_admit(NX_TELNET_SERVER *server_ptr, NXD_ADDRESS *source_ptr)
+{
+
+UINT                            i;
+UINT                            match;
+ULONG                           current_time;
+ULONG                           refills;
+NX_TELNET_SERVER_RATE_BUCKET    *bucket_ptr;
+NX_TELNET_SERVER_RATE_BUCKET    *candidate_ptr;
+
+
+    current_time =  tx_time_get();
+    bucket_ptr =  NX_NULL;
+
+    if (server_ptr -> nx_telnet_server_rate_burst)
+    {
+
+        /* Find the bucket of the address, otherwise an unused one or the one seen least recently.  */
+        candidate_ptr =  &(server_ptr -> nx_telnet_server_rate_buckets[0]);
+        for (i = 0; i < NX_TELNET_SERVER_RATE_SOURCES; i++)
+        {
+
+            bucket_ptr =  &(server_ptr -> nx_telnet_server_rate_buckets[i]);
+            match =  NX_FALSE;
+            if (bucket_ptr -> nx_telnet_rate_source.nxd_ip_version == source_ptr -> nxd_ip_version)
+            {
+#ifndef NX_DISABLE_IPV4
+                if (source_ptr -> nxd_ip_version == NX_IP_VERSION_V4)
+                    match =  (bucket_ptr -> nx_telnet_rate_source.nxd_ip_address.v4 == source_ptr -> nxd_ip_address.v4);
+#endif /* NX_DISABLE_IPV4 */
+#ifdef FEATURE_NX_IPV6
+                if (source_ptr -> nxd_ip_version == NX_IP_VERSION_V6)
+                    match =  CHECK_IPV6_ADDRESSES_SAME(bucket_ptr -> nx_telnet_rate_source.nxd_ip_address.v6,
+                                                       source_ptr -> nxd_ip_address.v6);
+#endif /* FEATURE_NX_IPV6 */
+            }
+            if (match)
+                break;
+
+            if ((candidate_ptr -> nx_telnet_rate_source.nxd_ip_version != 0) &&
+                ((bucket_ptr -> nx_telnet_rate_source.nxd_ip_version == 0) ||
+                 ((LONG) (bucket_ptr -> nx_telnet_rate_last_seen - candidate_ptr -> nx_telnet_rate_last_seen) < 0)))
+                candidate_ptr =  bucket_ptr;
+        }
+
+        if (i == NX_TELNET_SERVER_RATE_SOURCES)
+        {
+
+            /* A new address starts with a full burst.  */
+            bucket_ptr =  candidate_ptr;
+            bucket_ptr -> nx_telnet_rate_source =  *source_ptr;
+            bucket_ptr -> nx_telnet_rate_tokens =  server_ptr -> nx_telnet_server_rate_burst;
+            bucket_ptr -> nx_telnet_rate_refill_time =  current_time;
+        }
+        else
+        {
+
+            /* Add the tokens regained since the last refill, up to a full burst.  */
+            refills =  (current_time - bucket_ptr -> nx_telnet_rate_refill_time) / server_ptr -> nx_telnet_server_rate_refill;
+            if (refills >= (ULONG) (server_ptr -> nx_telnet_server_rate_burst - bucket_ptr -> nx_telnet_rate_tokens))
+            {
+                bucket_ptr -> nx_telnet_rate_tokens =  server_ptr -> nx_telnet_server_rate_burst;
+                bucket_ptr -> nx_telnet_rate_refill_time =  current_time;
+            }
+            else
+            {
+                bucket_ptr -> nx_telnet_rate_tokens +=  (UINT) refills;
+                bucket_ptr -> nx_telnet_rate_refill_time +=  refills * server_ptr -> nx_telnet_server_rate_refill;
+            }
+        }
+        bucket_ptr -> nx_telnet_rate_last_seen =  current_time;
+
+        /* Refuse the address, until it has regained a token.  */
+        if (bucket_ptr -> nx_telnet_rate_tokens == 0)
+        {
+            server_ptr -> nx_telnet_server_rate_rejects++;
+            return(NX_FALSE);
+        }
+    }
+
+    if (server_ptr -> nx_telnet_server_rate_global)
+    {
+
+        /* Count the connections of all clients in windows of one second.  */
+        if ((current_time - server_ptr -> nx_telnet_server_rate_window_start) >= NX_IP_PERIODIC_RATE)
+        {
+            server_ptr -> nx_telnet_server_rate_window_start =  current_time;
+            server_ptr -> nx_telnet_server_rate_window_count =  0;
+        }
+
+        if (server_ptr -> nx_telnet_server_rate_window_count >= server_ptr -> nx_telnet_server_rate_global)
+        {
+            server_ptr -> nx_telnet_server_flood_rejects++;
+            return(NX_FALSE);
+        }
+        server_ptr -> nx_telnet_server_rate_window_count++;
+    }
+
+    /* The address uses its token only, if the connection is admitted.  */
+    if (bucket_ptr)
+        bucket_ptr -> nx_telnet_rate_tokens--;
+
+    return(NX_TRUE);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_timer_schedule                    PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function arms the activity timer for the nearest deadline of   */ 
+/*    all client connections, or stops it if no connection can time out.  */ 
+/*    It is only called when a connection is added or a timeout changes,  */ 
+/*    so there is no periodic scan of the connections.                    */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    tx_timer_activate                     Activate TELNET server timer  */ 
+/*    tx_timer_change                       Change TELNET server timer    */ 
+/*    tx_timer_deactivate                   Deactivate TELNET server timer*/ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_connect_process     Connection processing         */ 
+/*    _nx_telnet_server_timeout_processing  Activity timeout processing   */ 
+/*                                                                        */ 
+/**************************************************************************/
+VOID  _nx_telnet_server_timer_schedule(NX_TELNET_SERVER *server_ptr)
+{
+
+UINT                        i;
+UINT                        armed;
+ULONG                       current_time;
+LONG                        remaining;
+LONG                        nearest;
+NX_TELNET_CLIENT_REQUEST   *client_req_ptr;
+
+
+    /* Pickup the current time.  */
+    current_time =  tx_time_get();
+
+    /* Find the deadline, that expires first.  */
+    armed =  NX_FALSE;
+    nearest =  0;
+    for (i = 0; i < server_ptr -> nx_telnet_server_max_clients; i++)
+    {
+
+        /* Set a pointer to client request structure.  */
+        client_req_ptr =  &(server_ptr -> nx_telnet_server_client_list[i]);
+
+        /* Skip sockets without a connection or without a timeout.  */
+        if ((client_req_ptr -> nx_telnet_client_request_activity_timeout == 0) ||
+            (client_req_ptr -> nx_telnet_client_request_activity_timeout == NX_TELNET_NO_ACTIVITY_TIMEOUT))
+            continue;
+
+        remaining =  (LONG) (client_req_ptr -> nx_telnet_client_request_deadline - current_time);
+        if ((armed == NX_FALSE) || (remaining < nearest))
+        {
+            armed =  NX_TRUE;
+            nearest =  remaining;
+        }
+    }
+
+    /* The timer must be stopped to change its expiration.  */
+    tx_timer_deactivate(&(server_ptr -> nx_telnet_server_timer));
+
+    if (armed)
+    {
+
+        /* A deadline, that has passed already, expires with the next tick.  */
+        if (nearest < 1)
+            nearest =  1;
+
+        tx_timer_change(&(server_ptr -> nx_telnet_server_timer), (ULONG) nearest, 0);
+        tx_timer_activate(&(server_ptr -> nx_telnet_server_timer));
+    }
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nxe_telnet_server_activity_timeout_set             PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function checks for errors in the TELNET server activity       */ 
+/*    timeout set service.                                                */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    logical_connection                    Logical connection entry      */ 
+/*    timeout                               Ticks allowed without activity*/ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    status                                Completion status             */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_activity_timeout_set                              */ 
+/*                                          Actual timeout set call       */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nxe_telnet_server_activity_timeout_set(NX_TELNET_SERVER *server_ptr, UINT logical_connection, ULONG timeout)
+{
+
+UINT    status;
+
+
+    /* Check for invalid input pointers.  */
+    if ((server_ptr == NX_NULL) || (server_ptr -> nx_telnet_server_id != NX_TELNET_SERVER_ID))
+        return(NX_PTR_ERROR);
+
+    /* Check for a valid logical connection and timeout.  */
+    if ((logical_connection >= server_ptr -> nx_telnet_server_max_clients) || (timeout == 0))
+        return(NX_OPTION_ERROR);
+
+    /* Call actual activity timeout set function.  */
+    status =  _nx_telnet_server_activity_timeout_set(server_ptr, logical_connection, timeout);
+
+    /* Return completion status.  */
+    return(status);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_activity_timeout_set              PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function changes the activity timeout of a connected client    */ 
+/*    and restarts it from now. NX_TELNET_NO_ACTIVITY_TIMEOUT keeps the   */ 
+/*    connection open without activity. The server thread re-arms the     */ 
+/*    activity timer for the new deadline.                                */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    logical_connection                    Logical connection entry      */ 
+/*    timeout                               Ticks allowed without activity*/ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    NX_SUCCESS                            Successful completion status  */ 
+/*    NX_TELNET_NOT_CONNECTED               Logical connection not open   */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    tx_event_flags_set                    Set events for server thread  */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nx_telnet_server_activity_timeout_set(NX_TELNET_SERVER *server_ptr, UINT logical_connection, ULONG timeout)
+{
+
+TX_INTERRUPT_SAVE_AREA
+
+NX_TELNET_CLIENT_REQUEST   *client_req_ptr;
+
+
+    /* Set a pointer to the indicated client connection.  */
+    client_req_ptr =  &(server_ptr -> nx_telnet_server_client_list[logical_connection]);
+
+    /* Change the timeout and the deadline together, as the server thread may look at them.  */
+    TX_DISABLE
+
+    /* Determine if the connection is open.  */
+    if (client_req_ptr -> nx_telnet_client_request_state != NX_TELNET_CLIENT_CONNECTED)
+    {
+
+        TX_RESTORE
+
+        /* No, the connection is not open.  */
+        return(NX_TELNET_NOT_CONNECTED);
+    }
+
+    client_req_ptr -> nx_telnet_client_request_activity_timeout =  timeout;
+    client_req_ptr -> nx_telnet_client_request_deadline =  tx_time_get() + timeout;
+
+    TX_RESTORE
+
+    /* Let the server thread re-arm the activity timer.  */
+    tx_event_flags_set(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_SERVER_ACTIVITY_TIMEOUT, TX_OR);
+
+    /* Return successful completion.  */
+    return(NX_SUCCESS);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nxe_telnet_server_receive_resume                   PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function checks for errors in the TELNET server receive resume */ 
+/*    service.                                                            */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    logical_connection                    Logical connection entry      */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    status                                Completion status             */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_receive_resume      Actual receive resume call    */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nxe_telnet_server_receive_resume(NX_TELNET_SERVER *server_ptr, UINT logical_connection)
+{
+
+UINT    status;
+
+
+    /* Check for invalid input pointers.  */
+    if ((server_ptr == NX_NULL) || (server_ptr -> nx_telnet_server_id != NX_TELNET_SERVER_ID))
+        return(NX_PTR_ERROR);
+
+    /* Check for a valid logical connection.  */
+    if (logical_connection >= server_ptr -> nx_telnet_server_max_clients)
+        return(NX_OPTION_ERROR);
+
+    /* Call actual receive resume function.  */
+    status =  _nx_telnet_server_receive_resume(server_ptr, logical_connection);
+
+    /* Return completion status.  */
+    return(status);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_receive_resume                    PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function lets the server thread receive again from a client,   */ 
+/*    that has been paused by the application. The data left on the      */ 
+/*    socket is picked up, as if it had just arrived.                     */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    logical_connection                    Logical connection entry      */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    NX_SUCCESS                            Successful completion status  */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    tx_event_flags_set                    Set events for server thread  */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nx_telnet_server_receive_resume(NX_TELNET_SERVER *server_ptr, UINT logical_connection)
+{
+
+    /* Clear the pause and mark the socket, as if new data was present.  */
+    server_ptr -> nx_telnet_server_client_list[logical_connection].nx_telnet_client_request_receive_paused =  NX_FALSE;
+    _nx_telnet_server_pending_set(server_ptr -> nx_telnet_server_data_pending, logical_connection);
+    tx_event_flags_set(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_SERVER_DATA, TX_OR);
+
+    /* Return successful completion.  */
+    return(NX_SUCCESS);
+}
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nxe_telnet_server_port_add                         PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function checks for errors in the TELNET server port add       */ 
+/*    service.                                                            */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    port                                  TCP port to listen on         */ 
+/*    max_clients                           Clients of the port           */ 
+/*    listener_index                        Returns the port index        */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    status                                Completion status             */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_port_add            Actual port add call          */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nxe_telnet_server_port_add(NX_TELNET_SERVER *server_ptr, UINT port, UINT max_clients, UINT *listener_index)
+{
+
+UINT    i;
+UINT    status;
+
+
+    /* Check for invalid input pointers.  */
+    if ((server_ptr == NX_NULL) || (server_ptr -> nx_telnet_server_id != NX_TELNET_SERVER_ID))
+        return(NX_PTR_ERROR);
+
+    /* Check for a free port entry and a client left on the first port.  */
+    if ((max_clients == 0) || (server_ptr -> nx_telnet_server_listener_count >= NX_TELNET_SERVER_MAX_PORTS) ||
+        (max_clients >= server_ptr -> nx_telnet_server_listeners[0].nx_telnet_listener_max_clients))
+        return(NX_SIZE_ERROR);
+
+    /* Check for a valid port, that is not used by the server yet.  */
+    if ((port == 0) || (port > 0xFFFF))
+        return(NX_TELNET_INVALID_PARAMETER);
+    for (i = 0; i < server_ptr -> nx_telnet_server_listener_count; i++)
+    {
+        if (server_ptr -> nx_telnet_server_listeners[i].nx_telnet_listener_port == port)
+            return(NX_TELNET_INVALID_PARAMETER);
+    }
+
+    /* Call actual port add function.  */
+    status =  _nx_telnet_server_port_add(server_ptr, port, max_clients, listener_index);
+
+    /* Return completion status.  */
+    return(status);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_port_add                          PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function adds a TCP port to the TELNET server, that is served  */ 
+/*    by the same server thread. The clients of the new port are taken    */ 
+/*    from the end of the client range of the first port. It must be     */ 
+/*    called after the server is created and before it is started.        */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    port                                  TCP port to listen on         */ 
+/*    max_clients                           Clients of the port           */ 
+/*    listener_index                        Returns the port index, may   */ 
+/*                                            be NX_NULL                  */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    NX_SUCCESS                            Successful completion status  */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nx_telnet_server_port_add(NX_TELNET_SERVER *server_ptr, UINT port, UINT max_clients, UINT *listener_index)
+{
+
+NX_TELNET_SERVER_LISTENER  *first_ptr;
+NX_TELNET_SERVER_LISTENER  *listener_ptr;
+
 
-                    /* Release the packet and continue the loop.  */
-                    nx_packet_release(packet_ptr);
-                }
-            }
-#else
-           if (*packet_ptr -> nx_packet_prepend_ptr == NX_TELNET_IAC)
-           {
-                nx_packet_release(packet_ptr);
-           }
-           /* Call the server receive callback.  */
-           else if (server_ptr -> nx_telnet_receive_data)
-           {
+    /* Take the clients from the end of the first port.  */
+    first_ptr =  &(server_ptr -> nx_telnet_server_listeners[0]);
+    first_ptr -> nx_telnet_listener_max_clients -=  max_clients;
 
-               /* Yes, there is a process data callback routine - call it!  */
-               (server_ptr -> nx_telnet_receive_data)(server_ptr, client_req_ptr -> nx_telnet_client_request_connection, packet_ptr);
-           }
-           else
-           {
+    /* Setup the new port behind the ports added before.  */
+    listener_ptr =  &(server_ptr -> nx_telnet_server_listeners[server_ptr -> nx_telnet_server_listener_count]);
+    listener_ptr -> nx_telnet_listener_port =  port;
+    listener_ptr -> nx_telnet_listener_first_client =  first_ptr -> nx_telnet_listener_first_client + first_ptr -> nx_telnet_listener_max_clients;
+    listener_ptr -> nx_telnet_listener_max_clients =  max_clients;
+    listener_ptr -> nx_telnet_listener_socket_ptr =  NX_NULL;
 
-               /* Error, no application callback routine.  */
+    /* Return the index of the port, connections of it report it in their client request.  */
+    if (listener_index)
+        *listener_index =  server_ptr -> nx_telnet_server_listener_count;
 
-               /* Release the packet and continue the loop.  */
-               nx_packet_release(packet_ptr);
-           }
+    server_ptr -> nx_telnet_server_listener_count++;
 
-#endif /* NX_TELNET_SERVER_OPTION_DISABLE */
-        }
-    }
+    /* Return successful completion.  */
+    return(NX_SUCCESS);
 }
 
 
@@ -2026,54 +3557,52 @@ UINT                        offset;
 /*                                                                        */ 
 /*  FUNCTION                                               RELEASE        */ 
 /*                                                                        */ 
-/*    _nx_telnet_server_timeout                           PORTABLE C      */ 
-/*                                                           6.1          */
-/*  AUTHOR                                                                */
-/*                                                                        */
-/*    Yuxin Zhou, Microsoft Corporation                                   */
-/*                                                                        */
-/*  DESCRIPTION                                                           */ 
+/*    _nxe_telnet_server_close_policy_set                 PORTABLE C      */ 
 /*                                                                        */ 
-/*    This function is the periodic timer for this TELNET server. Its     */ 
-/*    duty is to inform the TELNET server that it is time to check for    */
-/*    activity timeouts.                                                  */ 
+/*  DESCRIPTION                                                           */ 
 /*                                                                        */ 
+/*    This function checks for errors in the TELNET server close policy   */ 
+/*    set service.                                                        */ 
 /*                                                                        */ 
 /*  INPUT                                                                 */ 
 /*                                                                        */ 
-/*    telnet_server_address                 TELNET server's address       */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    policy                                Close policy                  */ 
+/*    timeout                               Ticks of a lingering close    */ 
 /*                                                                        */ 
 /*  OUTPUT                                                                */ 
 /*                                                                        */ 
-/*    None                                                                */ 
+/*    status                                Completion status             */ 
 /*                                                                        */ 
 /*  CALLS                                                                 */ 
 /*                                                                        */ 
-/*    tx_event_flags_set                    Set events for server thread  */ 
+/*    _nx_telnet_server_close_policy_set    Actual close policy set call  */ 
 /*                                                                        */ 
 /*  CALLED BY                                                             */ 
 /*                                                                        */ 
-/*    ThreadX                               ThreadX timer callback        */ 
-/*                                                                        */ 
-/*  RELEASE HISTORY                                                       */ 
+/*    Application Code                                                    */ 
 /*                                                                        */ 
-/*    DATE              NAME                      DESCRIPTION             */
-/*                                                                        */
-/*  05-19-2020     Yuxin Zhou               Initial Version 6.0           */
-/*  09-30-2020     Yuxin Zhou               Modified comment(s),          */
-/*                                            resulting in version 6.1    */
-/*                                                                        */
 /**************************************************************************/
-VOID  _nx_telnet_server_timeout(ULONG telnet_server_address)
+UINT  _nxe_telnet_server_close_policy_set(NX_TELNET_SERVER *server_ptr, UINT policy, ULONG timeout)
 {
 
-NX_TELNET_SERVER   *server_ptr;
+UINT    status;
 
-    /* Pickup server pointer.  */
-    server_ptr =  (NX_TELNET_SERVER *) telnet_server_address;
 
-    /* Set the data event flag.  */
-    tx_event_flags_set(&(server_ptr -> nx_telnet_server_event_flags), NX_TELNET_SERVER_ACTIVITY_TIMEOUT, TX_OR);
+    /* Check for invalid input pointers.  */
+    if ((server_ptr == NX_NULL) || (server_ptr -> nx_telnet_server_id != NX_TELNET_SERVER_ID))
+        return(NX_PTR_ERROR);
+
+    /* Check for a valid policy, a lingering close needs a deadline.  */
+    if ((policy > NX_TELNET_CLOSE_LINGER) || ((policy == NX_TELNET_CLOSE_LINGER) && 
+        ((timeout == 0) || (timeout == NX_WAIT_FOREVER))))
+        return(NX_TELNET_INVALID_PARAMETER);
+
+    /* Call actual close policy set function.  */
+    status =  _nx_telnet_server_close_policy_set(server_ptr, policy, timeout);
+
+    /* Return completion status.  */
+    return(status);
 }
 
 
@@ -2081,106 +3610,155 @@ NX_TELNET_SERVER   *server_ptr;
 /*                                                                        */ 
 /*  FUNCTION                                               RELEASE        */ 
 /*                                                                        */ 
-/*    _nx_telnet_server_timeout_processing                PORTABLE C      */ 
-/*                                                           6.1          */
-/*  AUTHOR                                                                */
-/*                                                                        */
-/*    Yuxin Zhou, Microsoft Corporation                                   */
-/*                                                                        */
+/*    _nx_telnet_server_close_policy_set                  PORTABLE C      */ 
+/*                                                                        */ 
 /*  DESCRIPTION                                                           */ 
 /*                                                                        */ 
-/*    This function reviews all the active TELNET client connections and  */ 
-/*    looks for an activity timeout. If a connection has not had any      */ 
-/*    activity within NX_TELNET_ACTIVITY_TIMEOUT seconds, the connection  */ 
-/*    is deleted and its resources are made available to a new connection.*/ 
+/*    This function sets how the server closes connections, whether the  */ 
+/*    application, the client or an activity timeout ends them:           */ 
 /*                                                                        */ 
+/*    NX_TELNET_CLOSE_GRACEFUL  the output is delivered and the FIN       */ 
+/*                              exchange finished, within                 */ 
+/*                              NX_TELNET_SERVER_CLOSE_TIMEOUT ticks      */ 
+/*    NX_TELNET_CLOSE_ABORTIVE  the socket is taken back at once          */ 
+/*    NX_TELNET_CLOSE_LINGER    like graceful, but the close is aborted   */ 
+/*                              after timeout ticks                       */ 
+/*                                                                        */ 
+/*    A short linger or an abortive close frees the socket of a client,   */ 
+/*    that connects only briefly, much earlier for the next client.       */ 
 /*                                                                        */ 
 /*  INPUT                                                                 */ 
 /*                                                                        */ 
 /*    server_ptr                            Pointer to TELNET server      */ 
+/*    policy                                Close policy                  */ 
+/*    timeout                               Ticks of a lingering close    */ 
 /*                                                                        */ 
 /*  OUTPUT                                                                */ 
 /*                                                                        */ 
-/*    None                                                                */ 
+/*    NX_SUCCESS                            Successful completion status  */ 
 /*                                                                        */ 
 /*  CALLS                                                                 */ 
 /*                                                                        */ 
-/*    nx_tcp_server_socket_relisten         Relisten for another connect  */ 
-/*    nx_tcp_server_socket_unaccept         Unaccept server connection    */ 
-/*    nx_tcp_socket_disconnect              Disconnect socket             */ 
+/*    None                                                                */ 
 /*                                                                        */ 
 /*  CALLED BY                                                             */ 
 /*                                                                        */ 
-/*    _nx_telnet_server_thread_entry        TELNET server thread          */ 
-/*                                                                        */ 
-/*  RELEASE HISTORY                                                       */ 
+/*    Application Code                                                    */ 
 /*                                                                        */ 
-/*    DATE              NAME                      DESCRIPTION             */
-/*                                                                        */
-/*  05-19-2020     Yuxin Zhou               Initial Version 6.0           */
-/*  09-30-2020     Yuxin Zhou               Modified comment(s),          */
-/*                                            resulting in version 6.1    */
-/*                                                                        */
 /**************************************************************************/
-VOID  _nx_telnet_server_timeout_processing(NX_TELNET_SERVER *server_ptr)
+UINT  _nx_telnet_server_close_policy_set(NX_TELNET_SERVER *server_ptr, UINT policy, ULONG timeout)
 {
 
-UINT                        i;
-NX_TELNET_CLIENT_REQUEST   *client_req_ptr;
+    /* A close, that has started already, keeps its deadline.  */
+    server_ptr -> nx_telnet_server_close_policy =  policy;
+    if (policy == NX_TELNET_CLOSE_LINGER)
+        server_ptr -> nx_telnet_server_close_timeout =  timeout;
+    else
+        server_ptr -> nx_telnet_server_close_timeout =  NX_TELNET_SERVER_CLOSE_TIMEOUT;
 
+    /* Return successful completion.  */
+    return(NX_SUCCESS);
+}
 
-    /* Now look through all the sockets.  */
-    for (i = 0; i < NX_TELNET_MAX_CLIENTS; i++)
-    {
 
-        /* Set a pointer to client request structure.  */
-        client_req_ptr =  &(server_ptr -> nx_telnet_server_client_list[i]);
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nxe_telnet_server_abort                            PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function checks for errors in the TELNET server abort call.    */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    logical_connection                    Logical connection entry      */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    status                                Completion status             */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_abort               Actual server abort call      */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nxe_telnet_server_abort(NX_TELNET_SERVER *server_ptr, UINT logical_connection)
+{
 
-        /* Now see if this socket has an activity timeout active.  */
-        if (client_req_ptr -> nx_telnet_client_request_activity_timeout)
-        {
+UINT    status;
 
-            /* Decrement the activity timeout for this client request.  */
-            if (client_req_ptr -> nx_telnet_client_request_activity_timeout > NX_TELNET_TIMEOUT_PERIOD)
-                client_req_ptr -> nx_telnet_client_request_activity_timeout =  client_req_ptr -> nx_telnet_client_request_activity_timeout - NX_TELNET_TIMEOUT_PERIOD;
-            else
-                client_req_ptr -> nx_telnet_client_request_activity_timeout =  0;
 
-            /* Determine if this entry has exceeded the activity timeout.  */
-            if (client_req_ptr -> nx_telnet_client_request_activity_timeout == 0)
-            {
+    /* Check for invalid input pointers.  */
+    if ((server_ptr == NX_NULL) || (server_ptr -> nx_telnet_server_id != NX_TELNET_SERVER_ID))
+        return(NX_PTR_ERROR);
 
-                /* Yes, the activity timeout has been exceeded.  Tear down and clean up the
-                   entire client request structure.  */
+    /* Check for a valid logical connection.  */
+    if (logical_connection >= server_ptr -> nx_telnet_server_max_clients)
+        return(NX_OPTION_ERROR);
 
-                /* Increment the activity timeout counter.  */
-                server_ptr -> nx_telnet_server_activity_timeouts++;
+    /* Check for appropriate caller.  */
+    NX_THREADS_ONLY_CALLER_CHECKING
 
-                /* Now disconnect the command socket.  */
-                nx_tcp_socket_disconnect(&(client_req_ptr -> nx_telnet_client_request_socket), NX_NO_WAIT);
+    /* Call actual server abort function.  */
+    status =  _nx_telnet_server_abort(server_ptr, logical_connection);
 
-                /* Unaccept the server socket.  */
-                nx_tcp_server_socket_unaccept(&(client_req_ptr -> nx_telnet_client_request_socket));
+    /* Return completion status.  */
+    return(status);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_abort                             PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function closes a connection like the disconnect service, but  */ 
+/*    always abortively, whatever the close policy of the server is. It   */ 
+/*    suits connections, that are rejected: output sent just before is    */ 
+/*    followed by the FIN at once, or by a RST unless                     */ 
+/*    NX_DISABLE_RESET_DISCONNECT is defined.                             */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    logical_connection                    Logical connection entry      */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    status                                Completion status             */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_disconnect          Close the connection          */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nx_telnet_server_abort(NX_TELNET_SERVER *server_ptr, UINT logical_connection)
+{
 
-                /* Relisten on this socket. This will probably fail, but it is needed just in case all available
-                   clients were in use at the time of the last relisten.  */
-                nx_tcp_server_socket_relisten(server_ptr -> nx_telnet_server_ip_ptr, NX_TELNET_SERVER_PORT, 
-                                                    &(client_req_ptr -> nx_telnet_client_request_socket));
+UINT    status;
 
-                /* Update number of current open connections. */
-                if (server_ptr -> nx_telnet_server_open_connections > 0)
-                    server_ptr -> nx_telnet_server_open_connections--;
 
-                /* Call the application's end connection callback routine.  */
-                if (server_ptr -> nx_telnet_connection_end)
-                {
+    /* Mark the connection before the server thread can start to close it.  */
+    server_ptr -> nx_telnet_server_client_list[logical_connection].nx_telnet_client_request_close_abort =  NX_TRUE;
 
-                    /* Yes, there is a connection end callback routine - call it!  */
-                    (server_ptr -> nx_telnet_connection_end)(server_ptr, client_req_ptr -> nx_telnet_client_request_connection);
-                }
-            }
-        }
-    }
+    status =  _nx_telnet_server_disconnect(server_ptr, logical_connection);
+
+    /* Return completion status.  */
+    return(status);
 }
 
 #ifndef NX_TELNET_SERVER_OPTION_DISABLE
@@ -2622,3 +4200,106 @@ UCHAR   *work_ptr;
     }
 }
 #endif /* NX_TELNET_SERVER_OPTION_DISABLE */
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nxe_telnet_server_rate_limit_set                   PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function checks for errors in the TELNET server rate limit set */ 
+/*    service.                                                            */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    burst                                 Connections of an address     */ 
+/*    refill                                Ticks to regain a connection  */ 
+/*    global                                Connections per second        */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    status                                Completion status             */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_rate_limit_set      Actual rate limit set call    */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nxe_telnet_server_rate_limit_set(NX_TELNET_SERVER *server_ptr, UINT burst, ULONG refill, UINT global)
+{
+
+UINT    status;
+
+
+    /* Check for invalid input pointers.  */
+    if ((server_ptr == NX_NULL) || (server_ptr -> nx_telnet_server_id != NX_TELNET_SERVER_ID))
+        return(NX_PTR_ERROR);
+
+    /* Check for a valid refill period, if the addresses are limited.  */
+    if (burst && ((refill == 0) || (refill == NX_WAIT_FOREVER)))
+        return(NX_TELNET_INVALID_PARAMETER);
+
+    /* Call actual rate limit set function.  */
+    status =  _nx_telnet_server_rate_limit_set(server_ptr, burst, refill, global);
+
+    /* Return completion status.  */
+    return(status);
+}
+
+
+/**************************************************************************/ 
+/*                                                                        */ 
+/*  FUNCTION                                               RELEASE        */ 
+/*                                                                        */ 
+/*    _nx_telnet_server_rate_limit_set                    PORTABLE C      */ 
+/*                                                                        */ 
+/*  DESCRIPTION                                                           */ 
+/*                                                                        */ 
+/*    This function sets the rate, at which new connections are accepted. */ 
+/*    A client address may open burst connections at once and one more   */ 
+/*    every refill ticks, all clients together global connections per    */ 
+/*    second. A connection over a limit is dropped without a reply,       */ 
+/*    before the server spends any work on it. A zero burst or global     */ 
+/*    disables the respective limit. The addresses seen so far are        */ 
+/*    forgotten.                                                          */ 
+/*                                                                        */ 
+/*  INPUT                                                                 */ 
+/*                                                                        */ 
+/*    server_ptr                            Pointer to TELNET server      */ 
+/*    burst                                 Connections of an address     */ 
+/*    refill                                Ticks to regain a connection  */ 
+/*    global                                Connections per second        */ 
+/*                                                                        */ 
+/*  OUTPUT                                                                */ 
+/*                                                                        */ 
+/*    NX_SUCCESS                            Successful completion status  */ 
+/*                                                                        */ 
+/*  CALLS                                                                 */ 
+/*                                                                        */ 
+/*    None                                                                */ 
+/*                                                                        */ 
+/*  CALLED BY                                                             */ 
+/*                                                                        */ 
+/*    Application Code                                                    */ 
+/*                                                                        */ 
+/**************************************************************************/
+UINT  _nx_telnet_server_rate_limit_set(NX_TELNET_SERVER *server_ptr, UINT burst, ULONG refill, UINT global)
+{
+
+    server_ptr -> nx_telnet_server_rate_burst =  burst;
+    server_ptr -> nx_telnet_server_rate_refill =  refill;
+    server_ptr -> nx_telnet_server_rate_global =  global;
+    server_ptr -> nx_telnet_server_rate_window_count =  0;
+    memset((void *) server_ptr -> nx_telnet_server_rate_buckets, 0, sizeof(server_ptr -> nx_telnet_server_rate_buckets));
+
+    /* Return successful completion.  */
+    return(NX_SUCCESS);
+}
@@ -84,12 +84,33 @@ extern   "C" {
 
 #endif /* NX_TELNET_SERVER_OPTION_DISABLE */
 
+/* Defined, the application passes the client list of every server to
+   nx_telnet_server_create_extended, nx_telnet_server_create is not available
+   and the server structure holds no client list of NX_TELNET_MAX_CLIENTS
+   clients. Required by the StaticServer of the C++ wrapper.
+#define NX_TELNET_SERVER_USER_CLIENT_LIST
+*/
+
 /* Define the maximum number of clients the TELNET Server can accommodate.  */
 
 #ifndef NX_TELNET_MAX_CLIENTS
 #define NX_TELNET_MAX_CLIENTS               4
 #endif
 
+/* Define the maximum number of clients of a server with a client list of the application.  */
+
+#ifndef NX_TELNET_SERVER_CLIENTS_LIMIT
+#define NX_TELNET_SERVER_CLIENTS_LIMIT      32
+#endif
+
+#if NX_TELNET_MAX_CLIENTS > NX_TELNET_SERVER_CLIENTS_LIMIT
+#error "NX_TELNET_MAX_CLIENTS must not exceed NX_TELNET_SERVER_CLIENTS_LIMIT"
+#endif
+
+/* Define the number of words of a bitmap with one bit per client socket.  */
+
+#define NX_TELNET_SERVER_BITMAP_WORDS       ((NX_TELNET_SERVER_CLIENTS_LIMIT + 31) / 32)
+
 
 /* Define TELNET TCP socket create options.  */
 
@@ -113,6 +134,25 @@ extern   "C" {
 #define NX_TELNET_SERVER_TIMEOUT            (10 * NX_IP_PERIODIC_RATE)
 #endif
 
+/* Define the ticks a client may take to complete the TCP handshake, before its socket is taken back.  */
+
+#ifndef NX_TELNET_SERVER_ACCEPT_TIMEOUT
+#define NX_TELNET_SERVER_ACCEPT_TIMEOUT     NX_TELNET_SERVER_TIMEOUT
+#endif
+
+/* Define the ticks a closing connection may take to deliver its output and finish the FIN exchange, before
+   its socket is taken back.  */
+
+#ifndef NX_TELNET_SERVER_CLOSE_TIMEOUT
+#define NX_TELNET_SERVER_CLOSE_TIMEOUT      NX_TELNET_SERVER_TIMEOUT
+#endif
+
+/* Define the ticks between checks of the handshakes and closes in progress, that NetX does not signal.  */
+
+#ifndef NX_TELNET_SERVER_POLL_PERIOD
+#define NX_TELNET_SERVER_POLL_PERIOD        ((NX_IP_PERIODIC_RATE / 10) ? (NX_IP_PERIODIC_RATE / 10) : 1)
+#endif
+
 #ifndef NX_TELNET_SERVER_PRIORITY
 #define NX_TELNET_SERVER_PRIORITY           16
 #endif
@@ -125,6 +165,8 @@ extern   "C" {
 #define NX_TELNET_TIMEOUT_PERIOD            60          /* Number of seconds to check                           */
 #endif
 
+#define NX_TELNET_NO_ACTIVITY_TIMEOUT       NX_WAIT_FOREVER /* Activity timeout that never expires          */
+
 
 /* Define TELNET commands that are optionally included in the TELNET data.  The application is responsible for
    recognizing and responding to the commands in accordance with the specification.  The TELNET option command
@@ -177,6 +219,24 @@ extern   "C" {
 #define NX_TELNET_ANY_EVENT                 0xFF        /* Any TELNET event                                     */
 
 
+/* Define the states of a TELNET client request.  */
+
+#define NX_TELNET_CLIENT_CLOSED             0           /* Socket is closed or listens                          */
+#define NX_TELNET_CLIENT_ACCEPTING          1           /* SYN+ACK is sent, the handshake is in progress        */
+#define NX_TELNET_CLIENT_CONNECTED          2           /* Connection is reported to the application            */
+#define NX_TELNET_CLIENT_DRAINING           3           /* Closing, output waits to be acknowledged             */
+#define NX_TELNET_CLIENT_CLOSING            4           /* Closing, FIN is sent                                 */
+
+
+/* Define the close policies of a TELNET Server.  The server never blocks on a close, it sends the FIN
+   with nx_tcp_socket_disconnect(NX_NO_WAIT).  NetX sends a RST instead, unless NX_DISABLE_RESET_DISCONNECT
+   is defined, so NX_TELNET_CLOSE_GRACEFUL and NX_TELNET_CLOSE_LINGER require it to close with a FIN.  */
+
+#define NX_TELNET_CLOSE_GRACEFUL            0           /* Deliver the output and finish the FIN exchange       */
+#define NX_TELNET_CLOSE_ABORTIVE            1           /* Take the socket back at once                         */
+#define NX_TELNET_CLOSE_LINGER              2           /* Close gracefully until a deadline, then abort        */
+
+
 /* Define return code constants.  */
 
 #define NX_TELNET_ERROR                     0xF0        /* TELNET internal error                                */ 
@@ -193,15 +253,79 @@ extern   "C" {
 #define NX_TELNET_SERVER_PORT               23          /* Default Port for TELNET server                       */
 #endif
 
+/* Define the maximum number of TCP ports a TELNET Server listens on with its one thread.  */
+
+#ifndef NX_TELNET_SERVER_MAX_PORTS
+#define NX_TELNET_SERVER_MAX_PORTS          4
+#endif
+
+/* Define the number of client addresses, whose connection rate is limited.  The address seen least recently
+   gives way to a new one.  */
+
+#ifndef NX_TELNET_SERVER_RATE_SOURCES
+#define NX_TELNET_SERVER_RATE_SOURCES       8
+#endif
+
+/* Define the connections a client address may open in a burst, 0 disables the limit per address.  */
+
+#ifndef NX_TELNET_SERVER_RATE_BURST
+#define NX_TELNET_SERVER_RATE_BURST         4
+#endif
+
+/* Define the ticks, after which a client address may open one more connection.  */
+
+#ifndef NX_TELNET_SERVER_RATE_REFILL
+#define NX_TELNET_SERVER_RATE_REFILL        (2 * NX_IP_PERIODIC_RATE)
+#endif
+
+/* Define the connections all clients together may open per second, 0 disables the limit.  */
+
+#ifndef NX_TELNET_SERVER_RATE_GLOBAL
+#define NX_TELNET_SERVER_RATE_GLOBAL        10
+#endif
+
+
+/* Define the per port structure for the TELNET Server data structure.  Each port owns a contiguous range
+   of the client list.  */
+
+typedef struct NX_TELNET_SERVER_LISTENER_STRUCT
+{
+    UINT            nx_telnet_listener_port;                            /* TCP port to listen on                */
+    UINT            nx_telnet_listener_first_client;                    /* First client request of the port     */
+    UINT            nx_telnet_listener_max_clients;                     /* Number of client requests            */
+    NX_TCP_SOCKET  *nx_telnet_listener_socket_ptr;                      /* Listening socket, NX_NULL if none    */
+} NX_TELNET_SERVER_LISTENER;
+
+
+/* Define the token bucket of a client address, that limits its connection rate.  */
+
+typedef struct NX_TELNET_SERVER_RATE_BUCKET_STRUCT
+{
+    NXD_ADDRESS     nx_telnet_rate_source;                              /* Client address, version 0 if unused  */
+    UINT            nx_telnet_rate_tokens;                              /* Connections left in the burst        */
+    ULONG           nx_telnet_rate_refill_time;                         /* Tick the last token was added        */
+    ULONG           nx_telnet_rate_last_seen;                           /* Tick of the last connection request  */
+} NX_TELNET_SERVER_RATE_BUCKET;
+
 
 /* Define the per client request structure for the TELNET Server data structure.  */
 
 typedef struct NX_TELNET_CLIENT_REQUEST_STRUCT
 {
     UINT            nx_telnet_client_request_connection;                /* Logical connection number            */
-    ULONG           nx_telnet_client_request_activity_timeout;          /* Timeout for client activity          */ 
+    UINT            nx_telnet_client_request_listener;                  /* Index of the port of the connection  */
+    UINT            nx_telnet_client_request_state;                     /* Closed, accepting, connected or      */
+                                                                        /*   closing                            */
+    UINT            nx_telnet_client_request_close_requested;           /* True if the application closes       */
+    UINT            nx_telnet_client_request_close_abort;               /* True to abort, whatever the policy   */
+    ULONG           nx_telnet_client_request_activity_timeout;          /* Ticks allowed without activity,      */
+                                                                        /*   non-zero while the socket is in    */
+                                                                        /*   use                                */
+    ULONG           nx_telnet_client_request_deadline;                  /* Tick the connection times out        */
     ULONG           nx_telnet_client_request_total_bytes;               /* Total bytes read or written          */ 
     NX_TCP_SOCKET   nx_telnet_client_request_socket;                    /* Client request socket                */ 
+    UINT            nx_telnet_client_request_receive_paused;            /* True while the application can not   */
+                                                                        /*   take data, leaves it on the socket */
 #ifndef NX_TELNET_SERVER_OPTION_DISABLE
     USHORT          nx_telnet_client_agree_server_will_echo_success;    /* True if server will echo negotiation success      */
     USHORT          nx_telnet_client_agree_server_will_SGA_success;     /* True if server will SGA negotiation success      */
@@ -223,7 +347,32 @@ typedef struct NX_TELNET_SERVER_STRUCT
     ULONG           nx_telnet_server_total_bytes_received;             /* Number of total bytes received        */ 
     ULONG           nx_telnet_server_relisten_errors;                  /* Number of relisten errors             */ 
     ULONG           nx_telnet_server_activity_timeouts;                /* Number of activity timeouts           */ 
+    ULONG           nx_telnet_server_accept_timeouts;                  /* Number of handshakes timed out        */
+    UINT            nx_telnet_server_accepting;                        /* Number of handshakes in progress      */
+    UINT            nx_telnet_server_closing;                          /* Number of closes in progress          */
+    ULONG           nx_telnet_server_close_aborts;                     /* Number of closes given up             */
+    UINT            nx_telnet_server_close_policy;                     /* How connections are closed            */
+    ULONG           nx_telnet_server_close_timeout;                    /* Ticks allowed for a graceful close    */
+    ULONG           nx_telnet_server_rate_rejects;                     /* Connections refused to one address    */
+    ULONG           nx_telnet_server_flood_rejects;                    /* Connections refused over global cap   */
+    UINT            nx_telnet_server_rate_burst;                       /* Connections of an address in a burst  */
+    ULONG           nx_telnet_server_rate_refill;                      /* Ticks to regain one connection        */
+    UINT            nx_telnet_server_rate_global;                      /* Connections of all clients per second */
+    UINT            nx_telnet_server_rate_window_count;                /* Connections in the current second     */
+    ULONG           nx_telnet_server_rate_window_start;                /* Tick the current second started       */
+    NX_TELNET_SERVER_RATE_BUCKET                                       /* Connection rate of client addresses   */
+                    nx_telnet_server_rate_buckets[NX_TELNET_SERVER_RATE_SOURCES];
     ULONG           nx_telnet_server_open_connections;                 /* Number of currently open connections  */ 
+    NX_TELNET_SERVER_LISTENER                                          /* TCP ports the server listens on,      */
+                    nx_telnet_server_listeners[NX_TELNET_SERVER_MAX_PORTS];/*   the first one is the default    */
+    UINT            nx_telnet_server_listener_count;                   /* Number of ports                       */
+    UINT            nx_telnet_server_option_requests_disable;          /* No option requests on connect         */
+    UINT            nx_telnet_server_raw_receive;                      /* Pass all data incl. telnet commands   */
+    ULONG           nx_telnet_server_activity_timeout;                 /* Ticks allowed without activity        */
+    ULONG           nx_telnet_server_connect_pending[NX_TELNET_SERVER_BITMAP_WORDS];    /* Sockets with connect event    */
+    ULONG           nx_telnet_server_disconnect_pending[NX_TELNET_SERVER_BITMAP_WORDS]; /* Sockets with disconnect event */
+    ULONG           nx_telnet_server_data_pending[NX_TELNET_SERVER_BITMAP_WORDS];       /* Sockets with receive data     */
+    ULONG           nx_telnet_server_closed[NX_TELNET_SERVER_BITMAP_WORDS];             /* Sockets ready to relisten     */
 
 #ifndef NX_TELNET_SERVER_OPTION_DISABLE
 #ifndef NX_TELNET_SERVER_USER_CREATE_PACKET_POOL
@@ -233,8 +382,13 @@ typedef struct NX_TELNET_SERVER_STRUCT
 #endif /* NX_TELNET_SERVER_USER_CREATE_PACKET_POOL */
     NX_PACKET_POOL *nx_telnet_server_packet_pool_ptr;                   /* Pointer to packet pool               */
 #endif /* NX_TELNET_SERVER_OPTION_DISABLE */
+#ifndef NX_TELNET_SERVER_USER_CLIENT_LIST
+    NX_TELNET_CLIENT_REQUEST                                           /* Client requests of a server created   */
+                    nx_telnet_server_client_area[NX_TELNET_MAX_CLIENTS];   /*   with nx_telnet_server_create    */
+#endif /* NX_TELNET_SERVER_USER_CLIENT_LIST */
     NX_TELNET_CLIENT_REQUEST                                           /* TELNET client request array           */ 
-                    nx_telnet_server_client_list[NX_TELNET_MAX_CLIENTS]; 
+                   *nx_telnet_server_client_list; 
+    UINT            nx_telnet_server_max_clients;                      /* Number of client requests             */
     TX_EVENT_FLAGS_GROUP
                     nx_telnet_server_event_flags;                      /* TELNET server thread events           */ 
     TX_TIMER        nx_telnet_server_timer;                            /* TELNET server activity timeout timer  */ 
@@ -258,7 +412,10 @@ typedef struct NX_TELNET_SERVER_STRUCT
 
 /* Services without error checking.  */
 
+#ifndef NX_TELNET_SERVER_USER_CLIENT_LIST
 #define nx_telnet_server_create                     _nx_telnet_server_create
+#endif /* NX_TELNET_SERVER_USER_CLIENT_LIST */
+#define nx_telnet_server_create_extended            _nx_telnet_server_create_extended
 #define nx_telnet_server_delete                     _nx_telnet_server_delete
 #define nx_telnet_server_disconnect                 _nx_telnet_server_disconnect
 #define nx_telnet_server_packet_send                _nx_telnet_server_packet_send
@@ -268,12 +425,21 @@ typedef struct NX_TELNET_SERVER_STRUCT
 #define nx_telnet_server_start                      _nx_telnet_server_start
 #define nx_telnet_server_stop                       _nx_telnet_server_stop
 #define nx_telnet_server_get_open_connection_count  _nx_telnet_server_get_open_connection_count
+#define nx_telnet_server_activity_timeout_set       _nx_telnet_server_activity_timeout_set
+#define nx_telnet_server_receive_resume             _nx_telnet_server_receive_resume
+#define nx_telnet_server_port_add                   _nx_telnet_server_port_add
+#define nx_telnet_server_close_policy_set           _nx_telnet_server_close_policy_set
+#define nx_telnet_server_abort                      _nx_telnet_server_abort
+#define nx_telnet_server_rate_limit_set             _nx_telnet_server_rate_limit_set
 
 #else
 
 /* Services with error checking.  */
 
+#ifndef NX_TELNET_SERVER_USER_CLIENT_LIST
 #define nx_telnet_server_create                     _nxe_telnet_server_create
+#endif /* NX_TELNET_SERVER_USER_CLIENT_LIST */
+#define nx_telnet_server_create_extended            _nxe_telnet_server_create_extended
 #define nx_telnet_server_delete                     _nxe_telnet_server_delete
 #define nx_telnet_server_disconnect                 _nxe_telnet_server_disconnect
 #define nx_telnet_server_packet_send                _nxe_telnet_server_packet_send
@@ -283,15 +449,28 @@ typedef struct NX_TELNET_SERVER_STRUCT
 #define nx_telnet_server_start                      _nxe_telnet_server_start
 #define nx_telnet_server_stop                       _nxe_telnet_server_stop
 #define nx_telnet_server_get_open_connection_count  _nxe_telnet_server_get_open_connection_count
+#define nx_telnet_server_activity_timeout_set       _nxe_telnet_server_activity_timeout_set
+#define nx_telnet_server_receive_resume             _nxe_telnet_server_receive_resume
+#define nx_telnet_server_port_add                   _nxe_telnet_server_port_add
+#define nx_telnet_server_close_policy_set           _nxe_telnet_server_close_policy_set
+#define nx_telnet_server_abort                      _nxe_telnet_server_abort
+#define nx_telnet_server_rate_limit_set             _nxe_telnet_server_rate_limit_set
 
 #endif
 
 /* Define the prototypes accessible to the application software.  */
 
+#ifndef NX_TELNET_SERVER_USER_CLIENT_LIST
 UINT    nx_telnet_server_create(NX_TELNET_SERVER *server_ptr, CHAR *server_name, NX_IP *ip_ptr, VOID *stack_ptr, ULONG stack_size, 
             void (*new_connection)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection), 
             void (*receive_data)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection, NX_PACKET *packet_ptr),
             void (*connection_end)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection));
+#endif /* NX_TELNET_SERVER_USER_CLIENT_LIST */
+UINT    nx_telnet_server_create_extended(NX_TELNET_SERVER *server_ptr, CHAR *server_name, NX_IP *ip_ptr, VOID *stack_ptr, ULONG stack_size, 
+            NX_TELNET_CLIENT_REQUEST *client_list, UINT max_clients, ULONG window_size,
+            void (*new_connection)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection), 
+            void (*receive_data)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection, NX_PACKET *packet_ptr),
+            void (*connection_end)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection));
 UINT    nx_telnet_server_delete(NX_TELNET_SERVER *server_ptr);
 UINT    nx_telnet_server_disconnect(NX_TELNET_SERVER *server_ptr, UINT logical_connection);
 UINT    nx_telnet_server_packet_send(NX_TELNET_SERVER *server_ptr, UINT logical_connection, NX_PACKET *packet_ptr, ULONG wait_option);
@@ -301,6 +480,12 @@ UINT    nx_telnet_server_packet_pool_set(NX_TELNET_SERVER *server_ptr, NX_PACKET
 UINT    nx_telnet_server_start(NX_TELNET_SERVER *server_ptr);
 UINT    nx_telnet_server_stop(NX_TELNET_SERVER *server_ptr);
 UINT    nx_telnet_server_get_open_connection_count(NX_TELNET_SERVER *server_ptr, UINT *current_connections);
+UINT    nx_telnet_server_activity_timeout_set(NX_TELNET_SERVER *server_ptr, UINT logical_connection, ULONG timeout);
+UINT    nx_telnet_server_receive_resume(NX_TELNET_SERVER *server_ptr, UINT logical_connection);
+UINT    nx_telnet_server_port_add(NX_TELNET_SERVER *server_ptr, UINT port, UINT max_clients, UINT *listener_index);
+UINT    nx_telnet_server_close_policy_set(NX_TELNET_SERVER *server_ptr, UINT policy, ULONG timeout);
+UINT    nx_telnet_server_abort(NX_TELNET_SERVER *server_ptr, UINT logical_connection);
+UINT    nx_telnet_server_rate_limit_set(NX_TELNET_SERVER *server_ptr, UINT burst, ULONG refill, UINT global);
 
 
 #else
@@ -315,6 +500,16 @@ UINT    _nx_telnet_server_create(NX_TELNET_SERVER *server_ptr, CHAR *server_name
             void (*new_connection)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection), 
             void (*receive_data)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection, NX_PACKET *packet_ptr),
             void (*connection_end)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection));
+UINT    _nxe_telnet_server_create_extended(NX_TELNET_SERVER *server_ptr, CHAR *server_name, NX_IP *ip_ptr, VOID *stack_ptr, ULONG stack_size, 
+            NX_TELNET_CLIENT_REQUEST *client_list, UINT max_clients, ULONG window_size,
+            void (*new_connection)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection), 
+            void (*receive_data)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection, NX_PACKET *packet_ptr),
+            void (*connection_end)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection));
+UINT    _nx_telnet_server_create_extended(NX_TELNET_SERVER *server_ptr, CHAR *server_name, NX_IP *ip_ptr, VOID *stack_ptr, ULONG stack_size, 
+            NX_TELNET_CLIENT_REQUEST *client_list, UINT max_clients, ULONG window_size,
+            void (*new_connection)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection), 
+            void (*receive_data)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection, NX_PACKET *packet_ptr),
+            void (*connection_end)(struct NX_TELNET_SERVER_STRUCT *telnet_server_ptr, UINT logical_connection));
 UINT    _nxe_telnet_server_delete(NX_TELNET_SERVER *server_ptr);
 UINT    _nx_telnet_server_delete(NX_TELNET_SERVER *server_ptr);
 UINT    _nxe_telnet_server_disconnect(NX_TELNET_SERVER *server_ptr, UINT logical_connection);
@@ -331,18 +526,42 @@ UINT    _nxe_telnet_server_stop(NX_TELNET_SERVER *server_ptr);
 UINT    _nx_telnet_server_stop(NX_TELNET_SERVER *server_ptr);
 UINT    _nxe_telnet_server_get_open_connection_count(NX_TELNET_SERVER *server_ptr, UINT *current_connections);
 UINT    _nx_telnet_server_get_open_connection_count(NX_TELNET_SERVER *server_ptr, UINT *current_connections);
+UINT    _nxe_telnet_server_activity_timeout_set(NX_TELNET_SERVER *server_ptr, UINT logical_connection, ULONG timeout);
+UINT    _nx_telnet_server_activity_timeout_set(NX_TELNET_SERVER *server_ptr, UINT logical_connection, ULONG timeout);
+UINT    _nxe_telnet_server_receive_resume(NX_TELNET_SERVER *server_ptr, UINT logical_connection);
+UINT    _nx_telnet_server_receive_resume(NX_TELNET_SERVER *server_ptr, UINT logical_connection);
+UINT    _nxe_telnet_server_port_add(NX_TELNET_SERVER *server_ptr, UINT port, UINT max_clients, UINT *listener_index);
+UINT    _nx_telnet_server_port_add(NX_TELNET_SERVER *server_ptr, UINT port, UINT max_clients, UINT *listener_index);
+UINT    _nxe_telnet_server_close_policy_set(NX_TELNET_SERVER *server_ptr, UINT policy, ULONG timeout);
+UINT    _nx_telnet_server_close_policy_set(NX_TELNET_SERVER *server_ptr, UINT policy, ULONG timeout);
+UINT    _nxe_telnet_server_abort(NX_TELNET_SERVER *server_ptr, UINT logical_connection);
+UINT    _nx_telnet_server_abort(NX_TELNET_SERVER *server_ptr, UINT logical_connection);
+UINT    _nxe_telnet_server_rate_limit_set(NX_TELNET_SERVER *server_ptr, UINT burst, ULONG refill, UINT global);
+UINT    _nx_telnet_server_rate_limit_set(NX_TELNET_SERVER *server_ptr, UINT burst, ULONG refill, UINT global);
 
 /* Define internal TELNET functions.  */
 
 VOID    _nx_telnet_server_thread_entry(ULONG telnet_server);
 VOID    _nx_telnet_server_connect_process(NX_TELNET_SERVER *server_ptr);
 VOID    _nx_telnet_server_connection_present(NX_TCP_SOCKET *socket_ptr, UINT port);
+VOID    _nx_telnet_server_establish_present(NX_TCP_SOCKET *socket_ptr);
+VOID    _nx_telnet_server_connection_established(NX_TELNET_SERVER *server_ptr, NX_TELNET_CLIENT_REQUEST *client_req_ptr);
+VOID    _nx_telnet_server_close_start(NX_TELNET_SERVER *server_ptr, NX_TELNET_CLIENT_REQUEST *client_req_ptr);
+VOID    _nx_telnet_server_close_continue(NX_TELNET_SERVER *server_ptr, NX_TELNET_CLIENT_REQUEST *client_req_ptr);
+VOID    _nx_telnet_server_close_abort(NX_TELNET_SERVER *server_ptr, NX_TELNET_CLIENT_REQUEST *client_req_ptr);
+VOID    _nx_telnet_server_close_finish(NX_TELNET_SERVER *server_ptr, NX_TELNET_CLIENT_REQUEST *client_req_ptr);
 VOID    _nx_telnet_server_disconnect_present(NX_TCP_SOCKET *socket_ptr);
 VOID    _nx_telnet_server_disconnect_process(NX_TELNET_SERVER *server_ptr);
 VOID    _nx_telnet_server_data_present(NX_TCP_SOCKET *socket_ptr);
 VOID    _nx_telnet_server_data_process(NX_TELNET_SERVER *server_ptr);
 VOID    _nx_telnet_server_timeout(ULONG telnet_server_address);
 VOID    _nx_telnet_server_timeout_processing(NX_TELNET_SERVER *server_ptr);
+VOID    _nx_telnet_server_timer_schedule(NX_TELNET_SERVER *server_ptr);
+UINT    _nx_telnet_server_socket_index(NX_TELNET_SERVER *server_ptr, NX_TCP_SOCKET *socket_ptr);
+VOID    _nx_telnet_server_pending_set(ULONG *bitmap, UINT index);
+UINT    _nx_telnet_server_pending_next(ULONG *bitmap, UINT *word_ptr, ULONG *bits_ptr, UINT *index_ptr);
+VOID    _nx_telnet_server_relisten(NX_TELNET_SERVER *server_ptr);
+UINT    _nx_telnet_server_rate_admit(NX_TELNET_SERVER *server_ptr, NXD_ADDRESS *source_ptr);
 
 #ifndef NX_TELNET_SERVER_OPTION_DISABLE
 UINT    _nx_telnet_server_send_option_requests(NX_TELNET_SERVER *server_ptr, NX_TELNET_CLIENT_REQUEST *client_req_ptr);